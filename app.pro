@@ -3,7 +3,7 @@ NAME = qrclip
 
 TARGET = $${PREFIX}-$${NAME}
 CONFIG += sailfishapp link_pkgconfig
-PKGCONFIG += sailfishapp
+PKGCONFIG += sailfishapp zlib
 QT += qml quick concurrent
 
 QMAKE_CXXFLAGS += -Wno-unused-parameter -Wno-psabi
@@ -21,6 +21,7 @@ HARBOUR_LIB_SRC = $${HARBOUR_LIB_DIR}/src
 HARBOUR_LIB_QML = $${HARBOUR_LIB_DIR}/qml
 
 LIBQRENCODE_DIR = $${_PRO_FILE_PWD_}/libqrencode
+LIBQRENCODE_EXT_DIR = $${_PRO_FILE_PWD_}/qrencode
 
 # Libraries
 LIBS +=  libqrencode.a -ldl
@@ -35,16 +36,39 @@ OTHER_FILES += \
 
 INCLUDEPATH += \
     src \
-    $${LIBQRENCODE_DIR}
+    $${LIBQRENCODE_DIR} \
+    $${LIBQRENCODE_EXT_DIR}
 
 HEADERS += \
+    src/BatchEncoder.h \
     src/FileUtils.h \
-    src/QrCodeModel.h
+    src/QrCodeArena.h \
+    src/QrCodeCache.h \
+    src/QrCodeGenerator.h \
+    src/QrCodeHistoryModel.h \
+    src/QrCodeImageProvider.h \
+    src/QrCodeModel.h \
+    src/QrCodeRegistry.h \
+    src/QrCodeScheduler.h \
+    src/QrCodeSnapshot.h \
+    src/QrCodeTrace.h \
+    src/StartupTimer.h
 
 SOURCES += \
     src/main.cpp \
+    src/BatchEncoder.cpp \
     src/FileUtils.cpp \
-    src/QrCodeModel.cpp
+    src/QrCodeArena.cpp \
+    src/QrCodeCache.cpp \
+    src/QrCodeGenerator.cpp \
+    src/QrCodeHistoryModel.cpp \
+    src/QrCodeImageProvider.cpp \
+    src/QrCodeModel.cpp \
+    src/QrCodeRegistry.cpp \
+    src/QrCodeScheduler.cpp \
+    src/QrCodeSnapshot.cpp \
+    src/QrCodeTrace.cpp \
+    src/StartupTimer.cpp
 
 # harbour-lib
 
@@ -56,14 +80,12 @@ HEADERS += \
     $${HARBOUR_LIB_INCLUDE}/HarbourClipboard.h \
     $${HARBOUR_LIB_INCLUDE}/HarbourDebug.h \
     $${HARBOUR_LIB_INCLUDE}/HarbourQrCodeGenerator.h \
-    $${HARBOUR_LIB_INCLUDE}/HarbourQrCodeImageProvider.h \
     $${HARBOUR_LIB_INCLUDE}/HarbourTask.h
 
 SOURCES += \
     $${HARBOUR_LIB_SRC}/HarbourBase32.cpp \
     $${HARBOUR_LIB_SRC}/HarbourClipboard.cpp \
     $${HARBOUR_LIB_SRC}/HarbourQrCodeGenerator.cpp \
-    $${HARBOUR_LIB_SRC}/HarbourQrCodeImageProvider.cpp \
     $${HARBOUR_LIB_SRC}/HarbourTask.cpp
 
 HARBOUR_QML_COMPONENTS = \
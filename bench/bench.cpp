@@ -0,0 +1,1339 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "FileUtils.h"
+#include "QrCodeArena.h"
+#include "QrCodeGenerator.h"
+#include "QrCodeImageProvider.h"
+#include "QrCodeModel.h"
+#include "QrCodeRegistry.h"
+#include "QrCodeScheduler.h"
+#include "QrCodeSnapshot.h"
+
+#include "HarbourBase32.h"
+#include "HarbourQrCodeGenerator.h"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QStandardPaths>
+#include <QtCore/QTemporaryDir>
+#include <QtTest/QSignalSpy>
+#include <QtTest/QtTest>
+
+#include "qrclip.h"
+
+// Internal libqrencode headers
+extern "C" {
+#include "qrspec.h"
+#include "mask.h"
+#include "rsecc.h"
+}
+
+#define BENCH_GALLERY_SUBDIR "qrclip-bench"
+#define BENCH_COUNT(a) ((int)(sizeof(a)/sizeof(a[0])))
+#define BENCH_OPS(a) a, BENCH_COUNT(a)
+
+// ==========================================================================
+// BenchQrClip
+// ==========================================================================
+
+class BenchQrClip :
+    public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Mode {
+        Numeric,
+        Alphanumeric,
+        Text
+    };
+
+    // What the data-driven benchmarks do with each row, see the names
+    // below. The same fixture is shared by everything of the same kind.
+    enum EncodeOp {
+        EncodeGenerate,
+        EncodeInput,
+        EncodeCapacity
+    };
+
+    enum BitsOp {
+        BitsToBase32,
+        BitsFromBase32,
+        BitsCreateImage,
+        BitsCreateScaledImage,
+        BitsRequestImage,
+        BitsWritePng,
+        BitsSaveToGallery,
+        BitsArena
+    };
+
+    enum FrameOp {
+        FrameMask,
+        FrameRsecc,
+        FrameRseccScalar
+    };
+
+    enum ModelsOp {
+        ModelsSingle,
+        ModelsShared
+    };
+
+    static QString payload(Mode, int);
+    static const char* levelName(int);
+    static const char* modeName(Mode);
+    static QByteArray rowName(const char*, const QByteArray&);
+    static void addTextRows(int, const char* const* aOps = Q_NULLPTR,
+        int aOpCount = 0);
+    static void addBitsRows(const char* const* aOps = Q_NULLPTR,
+        int aOpCount = 0);
+    static void addFrameRows(const char* const* aOps = Q_NULLPTR,
+        int aOpCount = 0);
+    static unsigned char* newFrame(int, int);
+    typedef int (*RsEncodeFunc)(size_t, size_t, const unsigned char*, unsigned char*);
+    static QByteArray encodeBlocks(int, int, const QByteArray&, RsEncodeFunc);
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    // Benchmarks
+    void encode_data();
+    void encode();
+    void packedBits_data();
+    void packedBits();
+    void frame_data();
+    void frame();
+    void segmentation();
+    void sequence_data();
+    void sequence();
+    void micro_data();
+    void micro();
+    void parallelMask_data();
+    void parallelMask();
+    void saveAllToGallery_data();
+    void saveAllToGallery();
+    void models_data();
+    void models();
+    void snapshot_data();
+    void snapshot();
+
+    // Unit tests
+    void sameCodes_data();
+    void sameCodes();
+    void optimalSegments_data();
+    void optimalSegments();
+    void structuredAppend_data();
+    void structuredAppend();
+    void capacity_data();
+    void capacity();
+    void allocations_data();
+    void allocations();
+#ifndef QRCLIP_SCALAR_MASK
+    void verifyMask_data();
+    void verifyMask();
+#endif
+#ifndef QRCLIP_SCALAR_RSECC
+    void verifyRsecc_data();
+    void verifyRsecc();
+#endif
+    void scaledImage_data();
+    void scaledImage();
+    void imageCache_data();
+    void imageCache();
+    void arenaHandles();
+    void snapshotRoundTrip();
+    void fileNames();
+};
+
+// Payload sizes (in characters). The largest ones don't fit into
+// the higher levels, which is also worth measuring.
+static const int benchSizes[] = { 16, 128, 512, 1024, 2900 };
+
+// Row name prefixes, in the order of the respective enums
+static const char* const benchEncodeOps[] = {
+    "generate",
+    "input",
+    "capacity"
+};
+
+static const char* const benchBitsOps[] = {
+    "toBase32",
+    "fromBase32",
+    "createImage",
+    "createScaledImage",
+    "requestImage",
+    "writePng",
+    "saveToGallery",
+    "arena"
+};
+
+static const char* const benchFrameOps[] = {
+    "mask",
+    "rsecc",
+#ifndef QRCLIP_SCALAR_RSECC
+    "rseccScalar"
+#endif
+};
+
+static const char* const benchModelsOps[] = {
+    "single",
+    "shared"
+};
+
+// The kind of things people copy
+static const char* const benchCorpus[] = {
+    "https://www.example.com/",
+    "https://www.example.com/watch?v=1234567890&t=3600",
+    "https://maps.example.org/@60.1699,24.9384,15z",
+    "https://shop.example.net/orders/20240517/items/000123456789",
+    "HTTPS://EXAMPLE.COM/INVOICE/2024/000451",
+    "+358 40 123 4567",
+    "tel:+14155552671",
+    "FI21 1234 5600 0007 85",
+    "4111 1111 1111 1111",
+    "1Z999AA10123456784",
+    "978-3-16-148410-0",
+    "WIFI:T:WPA;S:Home Network 5G;P:correct horse battery staple;;",
+    "otpauth://totp/Example:alice@example.com?secret=JBSWY3DPEHPK3PXP&issuer=Example",
+    "BEGIN:VCARD\nVERSION:3.0\nN:Doe;John\nTEL;TYPE=CELL:+1 555 0100 200\n"
+        "EMAIL:john.doe@example.com\nEND:VCARD",
+    "Meeting moved to 14:30, room B-204. Dial-in 0800 123 456, PIN 987654.",
+    "Tracking numbers: 00340434161094042557, 00340434161094042564, "
+        "00340434161094042571, 00340434161094042588",
+    "\xe6\x9d\xb1\xe4\xba\xac\xe9\x83\xbd\xe6\xb8\x8b\xe8\xb0\xb7"
+        "\xe5\x8c\xba\xe7\xa5\x9e\xe5\x8d\x97 1-2-3",
+    "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82, "
+        "\xd0\xbc\xd0\xb8\xd1\x80! 2024-05-17",
+    "The quick brown fox jumps over the lazy dog 0123456789 times."
+};
+
+QString
+BenchQrClip::payload(
+    Mode aMode,
+    int aSize)
+{
+    static const char alnum[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:";
+    QString text;
+    uint seed = 1;
+
+    // Deterministic, so that the numbers are comparable between runs
+    text.reserve(aSize);
+    for (int i = 0; i < aSize; i++) {
+        seed = seed * 1103515245 + 12345;
+        const uint r = (seed >> 16) & 0x7fff;
+        switch (aMode) {
+        case Numeric:
+            text.append(QChar('0' + (r % 10)));
+            break;
+        case Alphanumeric:
+            text.append(QChar(alnum[r % (sizeof(alnum) - 1)]));
+            break;
+        case Text:
+            text.append(QChar(' ' + (r % 95)));
+            break;
+        }
+    }
+    return text;
+}
+
+const char*
+BenchQrClip::levelName(
+    int aLevel)
+{
+    static const char* names[] = { "L", "M", "Q", "H" };
+    return (aLevel >= 0 && aLevel < 4) ? names[aLevel] : "?";
+}
+
+const char*
+BenchQrClip::modeName(
+    Mode aMode)
+{
+    switch (aMode) {
+    case Numeric: return "num";
+    case Alphanumeric: return "alnum";
+    case Text: return "text";
+    }
+    return "?";
+}
+
+QByteArray
+BenchQrClip::rowName(
+    const char* aOp,
+    const QByteArray& aName)
+{
+    return aOp ? (QByteArray(aOp) + "/" + aName) : aName;
+}
+
+void
+BenchQrClip::addTextRows(
+    int aLevels,
+    const char* const* aOps,
+    int aOpCount)
+{
+    static const Mode modes[] = { Numeric, Alphanumeric, Text };
+
+    // Without the op names, there's a single unnamed op
+    QTest::addColumn<int>("op");
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<int>("level");
+    for (int op = 0; op < qMax(aOpCount, 1); op++) {
+        const char* opName = aOps ? aOps[op] : Q_NULLPTR;
+        for (int l = 0; l < aLevels; l++) {
+            for (int m = 0; m < BENCH_COUNT(modes); m++) {
+                for (int s = 0; s < BENCH_COUNT(benchSizes); s++) {
+                    const QByteArray name(rowName(opName, QByteArray(levelName(l)) +
+                        "/" + modeName(modes[m]) + "/" + QByteArray::number(benchSizes[s])));
+                    QTest::newRow(name.constData()) << op <<
+                        payload(modes[m], benchSizes[s]) << l;
+                }
+            }
+        }
+    }
+}
+
+void
+BenchQrClip::addBitsRows(
+    const char* const* aOps,
+    int aOpCount)
+{
+    // Bits of the text codes of each size at the default level
+    QTest::addColumn<int>("op");
+    QTest::addColumn<QByteArray>("bits");
+    for (int op = 0; op < qMax(aOpCount, 1); op++) {
+        const char* opName = aOps ? aOps[op] : Q_NULLPTR;
+        for (int s = 0; s < BENCH_COUNT(benchSizes); s++) {
+            const QByteArray bits(HarbourQrCodeGenerator::generate(payload(Text,
+                benchSizes[s]), HarbourQrCodeGenerator::ECLevel_L));
+            if (!bits.isEmpty()) {
+                const QByteArray name(rowName(opName, "text/" +
+                    QByteArray::number(benchSizes[s]) + "/" +
+                    QByteArray::number(QrCodeImageProvider::moduleCount(bits))));
+                QTest::newRow(name.constData()) << op << bits;
+            }
+        }
+    }
+}
+
+void
+BenchQrClip::addFrameRows(
+    const char* const* aOps,
+    int aOpCount)
+{
+    QTest::addColumn<int>("op");
+    QTest::addColumn<int>("version");
+    QTest::addColumn<int>("level");
+    for (int op = 0; op < qMax(aOpCount, 1); op++) {
+        const char* opName = aOps ? aOps[op] : Q_NULLPTR;
+        for (int v = 1; v <= QRSPEC_VERSION_MAX; v++) {
+            for (int l = 0; l < HarbourQrCodeGenerator::ECLevelCount; l++) {
+                const QByteArray name(rowName(opName, QByteArray::number(v) +
+                    "/" + levelName(l)));
+                QTest::newRow(name.constData()) << op << v << l;
+            }
+        }
+    }
+}
+
+unsigned char*
+BenchQrClip::newFrame(
+    int aVersion,
+    int aLevel)
+{
+    // Unmasked frame with pseudo-random data modules
+    unsigned char* frame = QRspec_newFrame(aVersion);
+    if (frame) {
+        const int width = QRspec_getWidth(aVersion);
+        uint seed = aVersion * HarbourQrCodeGenerator::ECLevelCount + aLevel;
+        for (int i = 0; i < width * width; i++) {
+            if (!(frame[i] & 0x80)) {
+                seed = seed * 1103515245 + 12345;
+                frame[i] = (seed >> 16) & 1;
+            }
+        }
+    }
+    return frame;
+}
+
+QByteArray
+BenchQrClip::encodeBlocks(
+    int aVersion,
+    int aLevel,
+    const QByteArray& aData,
+    RsEncodeFunc aEncode)
+{
+    // Same block layout as RSblock_init() in libqrencode/qrencode.c
+    int spec[5];
+    QRspec_getEccSpec(aVersion, (QRecLevel)aLevel, spec);
+
+    const int n1 = QRspec_rsBlockNum1(spec);
+    const int n2 = QRspec_rsBlockNum2(spec);
+    const int dl1 = QRspec_rsDataCodes1(spec);
+    const int dl2 = QRspec_rsDataCodes2(spec);
+    const int el = QRspec_rsEccCodes1(spec);
+    const unsigned char* data = (const unsigned char*)aData.constData();
+    QByteArray ecc(QRspec_rsBlockNum(spec) * el, 0);
+    unsigned char* out = (unsigned char*)ecc.data();
+
+    Q_ASSERT(aData.size() >= n1 * dl1 + n2 * dl2);
+    for (int i = 0; i < n1; i++, data += dl1, out += el) {
+        aEncode(dl1, el, data, out);
+    }
+    for (int i = 0; i < n2; i++, data += dl2, out += el) {
+        aEncode(dl2, el, data, out);
+    }
+    return ecc;
+}
+
+void
+BenchQrClip::initTestCase()
+{
+    // saveToGallery() writes under ~/.qttest
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void
+BenchQrClip::cleanupTestCase()
+{
+    const QString dir(QStandardPaths::writableLocation(QStandardPaths::PicturesLocation) +
+        QDir::separator() + QLatin1String(BENCH_GALLERY_SUBDIR));
+    QDir(dir).removeRecursively();
+}
+
+// ==========================================================================
+// Benchmarks
+// ==========================================================================
+
+void
+BenchQrClip::encode_data()
+{
+    addTextRows(HarbourQrCodeGenerator::ECLevelCount, BENCH_OPS(benchEncodeOps));
+}
+
+void
+BenchQrClip::encode()
+{
+    QFETCH(int, op);
+    QFETCH(QString, text);
+    QFETCH(int, level);
+
+    // The input analysis is only shared by the "input" rows, the
+    // difference with "generate" is what each level saves by that
+    const HarbourQrCodeGenerator::ECLevel ecLevel =
+        (HarbourQrCodeGenerator::ECLevel)level;
+    const QrCodeGenerator::Input input(text);
+
+    QBENCHMARK {
+        switch ((EncodeOp)op) {
+        case EncodeGenerate:
+            HarbourQrCodeGenerator::generate(text, ecLevel);
+            break;
+        case EncodeInput:
+            QrCodeGenerator::generate(input, ecLevel);
+            break;
+        case EncodeCapacity:
+            QrCodeGenerator::Capacity(text).version(ecLevel);
+            break;
+        }
+    }
+}
+
+void
+BenchQrClip::packedBits_data()
+{
+    addBitsRows(BENCH_OPS(benchBitsOps));
+}
+
+void
+BenchQrClip::packedBits()
+{
+    QFETCH(int, op);
+    QFETCH(QByteArray, bits);
+
+    // Whatever each op needs, is prepared outside of the loop
+    const QByteArray base32(HarbourBase32::toBase32(bits).toLatin1());
+    const int scale = QrCodeImageProvider::scaleToFit(
+        QrCodeImageProvider::moduleCount(bits), 4, QSize(540, 540));
+    const QrCodeRegistry::Ref code(bits);
+    const QString id(code.id() + QLatin1String("?color=#ffffff"));
+    const QSize size(540, 540);
+    QrCodeImageProvider provider;
+    FileUtils fileUtils;
+    QBuffer buf;
+
+    QVERIFY(buf.open(QIODevice::WriteOnly));
+    if (op == BitsRequestImage) {
+        // Repeated requests are served from the cache
+        QVERIFY(!provider.requestImage(id, Q_NULLPTR, size).isNull());
+    }
+
+    QBENCHMARK {
+        switch ((BitsOp)op) {
+        case BitsToBase32:
+            HarbourBase32::toBase32(bits);
+            break;
+        case BitsFromBase32:
+            HarbourBase32::fromBase32(base32);
+            break;
+        case BitsCreateImage:
+            QrCodeImageProvider::createImage(bits);
+            break;
+        case BitsCreateScaledImage:
+            // Rendered straight at the size of a typical phone screen
+            QrCodeImageProvider::createImage(bits, QColor(Qt::black), scale, 4);
+            break;
+        case BitsRequestImage:
+            provider.requestImage(id, Q_NULLPTR, size);
+            break;
+        case BitsWritePng:
+            buf.seek(0);
+            QVERIFY(FileUtils::writePng(&buf, bits, 5));
+            break;
+        case BitsSaveToGallery:
+            QVERIFY(!fileUtils.saveToGallery(code.id(), BENCH_GALLERY_SUBDIR,
+                "qrcode", 5).isEmpty());
+            break;
+        case BitsArena:
+            // History sized churn, every other code is removed which
+            // eventually triggers the compaction
+            {
+                const int n = 100;
+                quint32 handle[n];
+
+                for (int i = 0; i < n; i++) {
+                    handle[i] = QrCodeArena::add(bits);
+                }
+                for (int i = 0; i < n; i += 2) {
+                    QrCodeArena::remove(handle[i]);
+                }
+                for (int i = 1; i < n; i += 2) {
+                    QrCodeArena::remove(handle[i]);
+                }
+            }
+            break;
+        }
+    }
+}
+
+void
+BenchQrClip::frame_data()
+{
+    addFrameRows(BENCH_OPS(benchFrameOps));
+}
+
+void
+BenchQrClip::frame()
+{
+    QFETCH(int, op);
+    QFETCH(int, version);
+    QFETCH(int, level);
+    const int width = QRspec_getWidth(version);
+    const QByteArray data(payload(Text, QRspec_getDataLength(version,
+        (QRecLevel)level)).toLatin1());
+    unsigned char* modules = newFrame(version, level);
+
+    QVERIFY(modules);
+    QBENCHMARK {
+        switch ((FrameOp)op) {
+        case FrameMask:
+            free(Mask_mask(width, modules, (QRecLevel)level));
+            break;
+        case FrameRsecc:
+            encodeBlocks(version, level, data, RSECC_encode);
+            break;
+        case FrameRseccScalar:
+            encodeBlocks(version, level, data, RSECC_encodeScalar);
+            break;
+        }
+    }
+    free(modules);
+}
+
+void
+BenchQrClip::segmentation()
+{
+    // Average version reduction and the end-to-end (text to PNG) time
+    // with the optimal segmentation, over the corpus and all levels
+    static const int Repeat = 20;
+    int codes = 0, smaller = 0, versions = 0;
+    qint64 elapsed[2] = { 0, 0 };
+    QElapsedTimer timer;
+
+    for (int i = 0; i < BENCH_COUNT(benchCorpus); i++) {
+        const QString text(QString::fromUtf8(benchCorpus[i]));
+        for (int l = 0; l < HarbourQrCodeGenerator::ECLevelCount; l++) {
+            const HarbourQrCodeGenerator::ECLevel level = (HarbourQrCodeGenerator::ECLevel)l;
+            QByteArray bits[2];
+            for (int s = 0; s < 2; s++) {
+                const QrCodeGenerator::Segmentation mode = s ?
+                    QrCodeGenerator::SegmentationOptimal :
+                    QrCodeGenerator::SegmentationGreedy;
+                timer.start();
+                for (int k = 0; k < Repeat; k++) {
+                    QBuffer buf;
+                    buf.open(QIODevice::WriteOnly);
+                    bits[s] = QrCodeGenerator::generate(text, level, mode);
+                    FileUtils::writePng(&buf, bits[s], 5);
+                }
+                elapsed[s] += timer.nsecsElapsed();
+            }
+            QVERIFY(!bits[0].isEmpty());
+            QVERIFY(!bits[1].isEmpty());
+            const int v0 = (QrCodeImageProvider::moduleCount(bits[0]) - 17) / 4;
+            const int v1 = (QrCodeImageProvider::moduleCount(bits[1]) - 17) / 4;
+            QVERIFY(v1 <= v0);
+            versions += v0 - v1;
+            if (v1 < v0) smaller++;
+            codes++;
+        }
+    }
+    qDebug("%d codes, %d smaller, %.2f versions less on average, %.2fx faster",
+        codes, smaller, (double)versions / codes, (double)elapsed[0] / elapsed[1]);
+}
+
+void
+BenchQrClip::sequence_data()
+{
+    // Structured append, for the texts which don't fit into a single
+    // symbol of the maximum version. Symbols are encoded one by one here.
+    static const int maxVersions[] = { 40, 25, 15 };
+
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<int>("level");
+    QTest::addColumn<int>("maxVersion");
+    for (uint v = 0; v < sizeof(maxVersions)/sizeof(maxVersions[0]); v++) {
+        const QByteArray name("text/2900/H/" + QByteArray::number(maxVersions[v]));
+        QTest::newRow(name.constData()) << payload(Text, 2900) <<
+            (int)HarbourQrCodeGenerator::ECLevel_H << maxVersions[v];
+    }
+}
+
+void
+BenchQrClip::sequence()
+{
+    QFETCH(QString, text);
+    QFETCH(int, level);
+    QFETCH(int, maxVersion);
+
+    const QrCodeGenerator::Input input(text);
+    const QrCodeGenerator::Sequence sequence(input,
+        (HarbourQrCodeGenerator::ECLevel)level, maxVersion);
+    const int n = sequence.count();
+
+    QVERIFY(n > 1);
+    QVERIFY(n <= QrCodeGenerator::Sequence::MaxCount);
+    QVERIFY(sequence.version() <= maxVersion);
+    qDebug("%d symbols, version %d", n, sequence.version());
+
+    QBENCHMARK {
+        for (int i = 0; i < n; i++) {
+            QrCodeGenerator::generate(sequence, i);
+        }
+    }
+}
+
+void
+BenchQrClip::micro_data()
+{
+    // Micro QR vs the smallest regular symbol for the same text
+    static const struct {
+        const char* text;
+        int level;
+        int version;
+    } rows[] = {
+        { "12345", HarbourQrCodeGenerator::ECLevel_L, 1 },
+        { "987654", HarbourQrCodeGenerator::ECLevel_M, 2 },
+        { "B-204", HarbourQrCodeGenerator::ECLevel_L, 2 },
+        { "pin: 4711", HarbourQrCodeGenerator::ECLevel_L, 3 },
+        { "1Z999AA10123456784", HarbourQrCodeGenerator::ECLevel_M, 4 },
+        { "https://www.example.com/", HarbourQrCodeGenerator::ECLevel_L, 0 }
+    };
+
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<int>("level");
+    QTest::addColumn<int>("version");
+    for (uint i = 0; i < sizeof(rows)/sizeof(rows[0]); i++) {
+        QTest::newRow(rows[i].text) << QString::fromLatin1(rows[i].text) <<
+            rows[i].level << rows[i].version;
+    }
+}
+
+void
+BenchQrClip::micro()
+{
+    QFETCH(QString, text);
+    QFETCH(int, level);
+    QFETCH(int, version);
+
+    const HarbourQrCodeGenerator::ECLevel ecLevel =
+        (HarbourQrCodeGenerator::ECLevel)level;
+    const QByteArray regular(QrCodeGenerator::generate(text, ecLevel));
+    const QByteArray micro(QrCodeGenerator::generateMicro(text, ecLevel));
+
+    QCOMPARE(QrCodeGenerator::microVersion(text, ecLevel), version);
+    if (version) {
+        // M1 is 11x11, each version adds 2 modules
+        QCOMPARE(QrCodeImageProvider::moduleCount(micro), 9 + 2 * version);
+        QVERIFY(QrCodeImageProvider::moduleCount(micro) <
+            QrCodeImageProvider::moduleCount(regular));
+        QBENCHMARK {
+            QrCodeGenerator::generateMicro(text, ecLevel);
+        }
+    } else {
+        QVERIFY(micro.isEmpty());
+    }
+}
+
+void
+BenchQrClip::parallelMask_data()
+{
+    // Large symbols at level H, where the mask trials cost the most
+    static const int sizes[] = { 256, 512, 1024 };
+
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<int>("minVersion");
+    for (uint i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++) {
+        const QByteArray name("text/" + QByteArray::number(sizes[i]));
+        QTest::newRow((name + "/serial").constData()) <<
+            payload(Text, sizes[i]) << 0;
+        QTest::newRow((name + "/parallel").constData()) <<
+            payload(Text, sizes[i]) << 1;
+    }
+}
+
+void
+BenchQrClip::parallelMask()
+{
+    QFETCH(QString, text);
+    QFETCH(int, minVersion);
+
+    const QrCodeGenerator::Input input(text);
+    const HarbourQrCodeGenerator::ECLevel level =
+        HarbourQrCodeGenerator::ECLevel_H;
+    const QByteArray serial(QrCodeGenerator::generate(input, level));
+
+    // The same mask must be chosen either way
+    QVERIFY(!serial.isEmpty());
+    QrCodeGenerator::setParallelMaskVersion(minVersion);
+    QCOMPARE(QrCodeGenerator::generate(input, level), serial);
+    QBENCHMARK {
+        QrCodeGenerator::generate(input, level);
+    }
+    QrCodeGenerator::setParallelMaskVersion(0);
+}
+
+void
+BenchQrClip::saveAllToGallery_data()
+{
+    addTextRows(1);
+}
+
+void
+BenchQrClip::saveAllToGallery()
+{
+    QFETCH(QString, text);
+
+    // All levels in one batch, in parallel
+    QStringList codes;
+    QList<QrCodeRegistry::Ref> refs;
+    for (int l = 0; l < HarbourQrCodeGenerator::ECLevelCount; l++) {
+        const QrCodeRegistry::Ref ref(QrCodeGenerator::generate(text,
+            (HarbourQrCodeGenerator::ECLevel)l));
+        if (!ref.isNull()) {
+            refs.append(ref);
+            codes.append(ref.id());
+        }
+    }
+    if (codes.isEmpty()) {
+        QSKIP("Too long");
+    }
+
+    FileUtils fileUtils;
+    QSignalSpy finished(&fileUtils, SIGNAL(saveFinished(int,QStringList,QString)));
+
+    QBENCHMARK {
+        const int id = fileUtils.saveAllToGallery(codes, BENCH_GALLERY_SUBDIR, "qrcode", 5);
+        QVERIFY(finished.wait());
+        const QList<QVariant> args(finished.takeFirst());
+        QCOMPARE(args.at(0).toInt(), id);
+        QCOMPARE(args.at(1).toStringList().count(), codes.count());
+        QVERIFY(args.at(2).toString().isEmpty());
+    }
+}
+
+void
+BenchQrClip::models_data()
+{
+    // setText() generates all levels
+    addTextRows(1, BENCH_OPS(benchModelsOps));
+}
+
+void
+BenchQrClip::models()
+{
+    // Either a single model, or several models sharing the worker
+    // threads, each one with its own strand. The first one has the
+    // priority.
+    QFETCH(int, op);
+    QFETCH(QString, text);
+    const int n = (op == ModelsShared) ? 4 : 1;
+    const QString texts[2] = { text, text.mid(1) };
+    QrCodeModel model[4];
+    int i = 0;
+
+    model[0].setPriority(QrCodeModel::HighPriority);
+    for (int k = 0; k < n; k++) {
+        // Measure generation, not the cache
+        model[k].setCacheCapacity(0);
+    }
+    QBENCHMARK {
+        for (int k = 0; k < n; k++) {
+            model[k].setText(texts[(i + k) % 2]);
+        }
+        i++;
+        for (int k = 0; k < n; k++) {
+            QSignalSpy running(model + k, SIGNAL(runningChanged()));
+            while (model[k].isRunning()) {
+                QVERIFY(running.wait());
+            }
+        }
+    }
+    QCOMPARE(QrCodeScheduler::runningCount(), 0);
+}
+
+void
+BenchQrClip::snapshot_data()
+{
+    addTextRows(1);
+}
+
+void
+BenchQrClip::snapshot()
+{
+    QFETCH(QString, text);
+    QTemporaryDir dir;
+    const QString path(dir.path() + QLatin1String("/snapshot"));
+    QrCodeModel model;
+    QSignalSpy running(&model, SIGNAL(runningChanged()));
+
+    model.setText(text);
+    while (model.isRunning()) {
+        QVERIFY(running.wait());
+    }
+
+    const QrCodeSnapshot saved(model.snapshot());
+    QVERIFY(!saved.isEmpty());
+    QVERIFY(saved.save(path));
+
+    // Cold start with the matching text, nothing gets encoded
+    QBENCHMARK {
+        QrCodeSnapshot::setStartup(QrCodeSnapshot::load(path));
+        QrCodeModel restored;
+        restored.setText(text);
+        QVERIFY(!restored.isRunning());
+        QCOMPARE(restored.codeBits(HarbourQrCodeGenerator::ECLevel_L),
+            model.codeBits(HarbourQrCodeGenerator::ECLevel_L));
+    }
+}
+
+// ==========================================================================
+// Unit tests
+// ==========================================================================
+
+void
+BenchQrClip::sameCodes_data()
+{
+    addTextRows(HarbourQrCodeGenerator::ECLevelCount);
+}
+
+void
+BenchQrClip::sameCodes()
+{
+    QFETCH(QString, text);
+    QFETCH(int, level);
+
+    // Shared input analysis must produce the same codes as the
+    // separate HarbourQrCodeGenerator::generate() calls
+    const HarbourQrCodeGenerator::ECLevel ecLevel =
+        (HarbourQrCodeGenerator::ECLevel)level;
+    const QByteArray bits(HarbourQrCodeGenerator::generate(text, ecLevel));
+    const QrCodeGenerator::Input input(text);
+
+    QCOMPARE(QrCodeGenerator::generate(text, ecLevel), bits);
+    QCOMPARE(QrCodeGenerator::generate(input, ecLevel), bits);
+}
+
+void
+BenchQrClip::optimalSegments_data()
+{
+    // The versions (L, M, Q and H) are worked out by hand, from the
+    // cheapest sequence of segments and the data capacity of each
+    // version. All-byte encoding would need a larger one, except for
+    // the first row which has nothing else in it.
+    static const struct {
+        const char* text;
+        int version[HarbourQrCodeGenerator::ECLevelCount];
+    } rows[] = {
+        { "https://www.example.com/", { 2, 2, 3, 3 } },
+        { "12345678901234567890123456789012345678901234567890",
+          { 2, 2, 3, 3 } },
+        { "Order 12345678901234567890123456789012 shipped", { 2, 3, 3, 4 } },
+        { "Tracking numbers: 00340434161094042557, 00340434161094042564",
+          { 3, 3, 4, 5 } }
+    };
+
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<int>("level");
+    QTest::addColumn<int>("version");
+    for (int i = 0; i < BENCH_COUNT(rows); i++) {
+        for (int l = 0; l < HarbourQrCodeGenerator::ECLevelCount; l++) {
+            const QByteArray name(QByteArray::number(i) + "/" + levelName(l));
+            QTest::newRow(name.constData()) <<
+                QString::fromLatin1(rows[i].text) << l << rows[i].version[l];
+        }
+    }
+}
+
+void
+BenchQrClip::optimalSegments()
+{
+    QFETCH(QString, text);
+    QFETCH(int, level);
+    QFETCH(int, version);
+
+    const HarbourQrCodeGenerator::ECLevel ecLevel =
+        (HarbourQrCodeGenerator::ECLevel)level;
+    const QByteArray bits(QrCodeGenerator::generate(text, ecLevel,
+        QrCodeGenerator::SegmentationOptimal));
+    const QByteArray greedy(QrCodeGenerator::generate(text, ecLevel,
+        QrCodeGenerator::SegmentationGreedy));
+    const QrCodeGenerator::Input input(text,
+        QrCodeGenerator::SegmentationOptimal);
+
+    // Exactly the smallest version, never worse than the greedy
+    // splitter, and the capacity estimate is a lower bound
+    QVERIFY(!bits.isEmpty());
+    QVERIFY(!greedy.isEmpty());
+    QCOMPARE((QrCodeImageProvider::moduleCount(bits) - 17) / 4, version);
+    QVERIFY((QrCodeImageProvider::moduleCount(greedy) - 17) / 4 >= version);
+    QVERIFY(QrCodeGenerator::Capacity(text).version(ecLevel) <= version);
+    QCOMPARE(QrCodeGenerator::generate(input, ecLevel), bits);
+}
+
+void
+BenchQrClip::structuredAppend_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<int>("level");
+    QTest::addColumn<int>("maxVersion");
+    QTest::newRow("num/3000/L/5") << payload(Numeric, 3000) <<
+        (int)HarbourQrCodeGenerator::ECLevel_L << 5;
+    QTest::newRow("alnum/1000/M/10") << payload(Alphanumeric, 1000) <<
+        (int)HarbourQrCodeGenerator::ECLevel_M << 10;
+    QTest::newRow("text/2900/H/40") << payload(Text, 2900) <<
+        (int)HarbourQrCodeGenerator::ECLevel_H << 40;
+}
+
+void
+BenchQrClip::structuredAppend()
+{
+    QFETCH(QString, text);
+    QFETCH(int, level);
+    QFETCH(int, maxVersion);
+
+    const HarbourQrCodeGenerator::ECLevel ecLevel =
+        (HarbourQrCodeGenerator::ECLevel)level;
+    const QrCodeGenerator::Input input(text);
+    const QrCodeGenerator::Sequence sequence(input, ecLevel, maxVersion);
+    const int n = sequence.count();
+    const int version = sequence.version();
+
+    QVERIFY(n > 1);
+    QVERIFY(n <= QrCodeGenerator::Sequence::MaxCount);
+    QVERIFY(version <= maxVersion);
+
+    // All symbols are of the same version, each one is different
+    QByteArray prev;
+    for (int i = 0; i < n; i++) {
+        const QByteArray bits(QrCodeGenerator::generate(sequence, i));
+        QCOMPARE(QrCodeImageProvider::moduleCount(bits), 17 + 4 * version);
+        QVERIFY(bits != prev);
+        prev = bits;
+    }
+    QVERIFY(QrCodeGenerator::generate(sequence, n).isEmpty());
+
+    // The smallest version which doesn't need more symbols is picked
+    if (version > 1) {
+        const QrCodeGenerator::Sequence smaller(input, ecLevel, version - 1);
+        QVERIFY(!smaller.count() || smaller.count() > n);
+    }
+
+    // None of it fits into 16 symbols of version 1
+    QCOMPARE(QrCodeGenerator::Sequence(input, ecLevel, 1).count(), 0);
+
+    // No splitting if the text fits into a single symbol anyway
+    const QrCodeGenerator::Input head(text.left(16));
+    const QrCodeGenerator::Sequence single(head, ecLevel, maxVersion);
+    QCOMPARE(single.count(), 1);
+}
+
+void
+BenchQrClip::capacity_data()
+{
+    addTextRows(HarbourQrCodeGenerator::ECLevelCount);
+}
+
+void
+BenchQrClip::capacity()
+{
+    QFETCH(QString, text);
+    QFETCH(int, level);
+
+    const HarbourQrCodeGenerator::ECLevel ecLevel =
+        (HarbourQrCodeGenerator::ECLevel)level;
+    const QrCodeGenerator::Capacity capacity(text);
+    const int version = capacity.version(ecLevel);
+    const QByteArray bits(QrCodeGenerator::generate(text, ecLevel,
+        QrCodeGenerator::SegmentationOptimal));
+
+    // It's a lower bound, the levels it rules out must really not fit
+    if (!version) {
+        QVERIFY(bits.isEmpty());
+    } else if (!bits.isEmpty()) {
+        QVERIFY(17 + 4 * version <= QrCodeImageProvider::moduleCount(bits));
+    }
+}
+
+void
+BenchQrClip::allocations_data()
+{
+    addTextRows(HarbourQrCodeGenerator::ECLevelCount);
+}
+
+void
+BenchQrClip::allocations()
+{
+    QFETCH(QString, text);
+    QFETCH(int, level);
+
+    const QByteArray utf8(text.toUtf8());
+    const QrCodeGenerator::Input input(text);
+    const HarbourQrCodeGenerator::ECLevel ecLevel =
+        (HarbourQrCodeGenerator::ECLevel)level;
+    QRclipAllocStats plain, cold, warm;
+
+    // Plain libqrencode, straight to the heap
+    QRclip_resetAllocStats();
+    QRcode* code = QRcode_encodeString(utf8.constData(), 0, (QRecLevel)level,
+        QR_MODE_8, 1);
+    if (!code) {
+        QSKIP("Too long");
+    }
+    QRcode_free(code);
+    QRclip_getAllocStats(&plain);
+
+    // The first code may have to grow the arena, the next one
+    // must not touch the heap at all
+    QRclip_resetAllocStats();
+    const QByteArray bits(QrCodeGenerator::generate(input, ecLevel));
+    QRclip_getAllocStats(&cold);
+    QRclip_resetAllocStats();
+    QCOMPARE(QrCodeGenerator::generate(input, ecLevel), bits);
+    QRclip_getAllocStats(&warm);
+    QCOMPARE(warm.heap_allocs, 0ul);
+
+    qDebug("%lu allocations, %lu heap (%lu plain, %lu cold), %u bytes peak",
+        warm.allocs, warm.heap_allocs, plain.heap_allocs, cold.heap_allocs,
+        (uint)warm.peak_bytes);
+}
+
+#ifndef QRCLIP_SCALAR_MASK
+
+void
+BenchQrClip::verifyMask_data()
+{
+    addFrameRows();
+}
+
+void
+BenchQrClip::verifyMask()
+{
+    QFETCH(int, version);
+    QFETCH(int, level);
+    unsigned char* frame = newFrame(version, level);
+
+    // Bit-parallel penalties must match the original ones
+    QVERIFY(frame);
+    QCOMPARE(QRclip_verifyMask(QRspec_getWidth(version), frame, (QRecLevel)level), 0);
+    free(frame);
+}
+
+#endif // QRCLIP_SCALAR_MASK
+
+#ifndef QRCLIP_SCALAR_RSECC
+
+void
+BenchQrClip::verifyRsecc_data()
+{
+    addFrameRows();
+}
+
+void
+BenchQrClip::verifyRsecc()
+{
+    QFETCH(int, version);
+    QFETCH(int, level);
+    const int n = QRspec_getDataLength(version, (QRecLevel)level);
+
+    // Table-driven ECC must match the original one, for any data
+    for (int i = 0; i < HarbourQrCodeGenerator::ECLevelCount; i++) {
+        const QByteArray data(payload((Mode)(i % (Text + 1)), n).toLatin1());
+        QCOMPARE(encodeBlocks(version, level, data, RSECC_encode),
+            encodeBlocks(version, level, data, RSECC_encodeScalar));
+    }
+}
+
+#endif // QRCLIP_SCALAR_RSECC
+
+void
+BenchQrClip::scaledImage_data()
+{
+    addBitsRows();
+}
+
+void
+BenchQrClip::scaledImage()
+{
+    QFETCH(QByteArray, bits);
+
+    // Each module becomes a scale x scale square, plus the margin
+    const int n = QrCodeImageProvider::moduleCount(bits);
+    const int scale = QrCodeImageProvider::scaleToFit(n, 4, QSize(540, 540));
+    const QImage img(QrCodeImageProvider::createImage(bits, QColor(Qt::black),
+        scale, 4));
+    const QImage ref(QrCodeImageProvider::createImage(bits));
+
+    QCOMPARE(img.width(), (n + 8) * scale);
+    QCOMPARE(img.pixelIndex(0, 0), 0);
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            const int i = ref.pixelIndex(x, y);
+            QCOMPARE(img.pixelIndex((x + 4) * scale, (y + 4) * scale), i);
+            QCOMPARE(img.pixelIndex((x + 5) * scale - 1, (y + 5) * scale - 1), i);
+        }
+    }
+}
+
+void
+BenchQrClip::imageCache_data()
+{
+    addBitsRows();
+}
+
+void
+BenchQrClip::imageCache()
+{
+    QFETCH(QByteArray, bits);
+
+    // Repeated requests are served from the cache
+    const QrCodeRegistry::Ref code(bits);
+    const QString id(code.id() + QLatin1String("?color=#ffffff"));
+    const QSize size(540, 540);
+    QrCodeImageProvider provider;
+    const QImage img(provider.requestImage(id, Q_NULLPTR, size));
+
+    QVERIFY(!img.isNull());
+    QCOMPARE(provider.cacheMisses(), 1u);
+    QCOMPARE(provider.requestImage(id, Q_NULLPTR, size), img);
+    QCOMPARE(provider.cacheHits(), 1u);
+}
+
+void
+BenchQrClip::arenaHandles()
+{
+    // The arena is process-wide, whatever is already there stays
+    const int base = QrCodeArena::size();
+    const int n = 64;
+    QByteArray bits[n];
+    quint32 handle[n];
+    int size = base;
+
+    QCOMPARE(QrCodeArena::add(QByteArray()), 0u);
+    QCOMPARE(QrCodeArena::id(0), QString());
+    for (int i = 0; i < n; i++) {
+        bits[i] = QByteArray(i + 1, (char)i);
+        handle[i] = QrCodeArena::add(bits[i]);
+        QVERIFY(handle[i]);
+        QVERIFY(QrCodeArena::isId(QrCodeArena::id(handle[i])));
+        QCOMPARE(QrCodeArena::find(QrCodeArena::id(handle[i])), bits[i]);
+        size += bits[i].size();
+    }
+    QCOMPARE(QrCodeArena::size(), size);
+
+    // Removing 3 out of 4 codes compacts the buffer, the remaining
+    // ones keep their handles and their bits
+    for (int i = 0; i < n; i++) {
+        if (i % 4) {
+            QrCodeArena::remove(handle[i]);
+            size -= bits[i].size();
+        }
+    }
+    QCOMPARE(QrCodeArena::size(), size);
+    QVERIFY(QrCodeArena::capacity() <= 2 * size + 1);
+    for (int i = 0; i < n; i++) {
+        const QString id(QrCodeArena::id(handle[i]));
+        if (i % 4) {
+            QVERIFY(QrCodeArena::bits(handle[i]).isEmpty());
+            QVERIFY(QrCodeArena::find(id).isEmpty());
+        } else {
+            QCOMPARE(QrCodeArena::bits(handle[i]), bits[i]);
+            QCOMPARE(QrCodeArena::find(id), bits[i]);
+        }
+    }
+
+    // Removed handles aren't reused right away
+    const quint32 last = QrCodeArena::add(bits[0]);
+    for (int i = 0; i < n; i++) {
+        QVERIFY(last != handle[i]);
+    }
+    QrCodeArena::remove(last);
+    QrCodeArena::remove(last);
+
+    // Not the arena ids
+    QVERIFY(!QrCodeArena::isId(QString()));
+    QVERIFY(!QrCodeArena::isId(QString("~")));
+    QVERIFY(!QrCodeArena::isId(HarbourBase32::toBase32(bits[n - 1])));
+    QVERIFY(QrCodeArena::find(QString("~!")).isEmpty());
+
+    for (int i = 0; i < n; i += 4) {
+        QrCodeArena::remove(handle[i]);
+    }
+    QCOMPARE(QrCodeArena::size(), base);
+}
+
+void
+BenchQrClip::snapshotRoundTrip()
+{
+    const QString text("https://www.example.com/");
+    const QByteArray a(QrCodeGenerator::generate(text, HarbourQrCodeGenerator::ECLevel_L));
+    const QByteArray b(QrCodeGenerator::generate(text, HarbourQrCodeGenerator::ECLevel_H));
+    QTemporaryDir dir;
+    const QString path(dir.path() + QLatin1String("/snapshot"));
+    QrCodeSnapshot saved(text, true, 25, false, true);
+
+    // A single symbol, a sequence and the level which didn't fit
+    QVERIFY(!a.isEmpty());
+    QVERIFY(!b.isEmpty());
+    QVERIFY(saved.isEmpty());
+    saved.insert(0, QrCodeSnapshot::Symbols() << a);
+    saved.insert(1, QrCodeSnapshot::Symbols() << a << b);
+    saved.insert(3, QrCodeSnapshot::Symbols());
+    QVERIFY(!saved.isEmpty());
+    QVERIFY(saved.save(path));
+
+    const QrCodeSnapshot loaded(QrCodeSnapshot::load(path));
+    QCOMPARE(loaded.levels(), QList<int>() << 0 << 1 << 3);
+    QCOMPARE(loaded.symbols(0), saved.symbols(0));
+    QCOMPARE(loaded.symbols(1), saved.symbols(1));
+    QVERIFY(loaded.symbols(2).isEmpty());
+    QVERIFY(loaded.symbols(3).isEmpty());
+
+    // The text and all the parameters must match
+    QVERIFY(loaded.matches(text, true, 25, false, true));
+    QVERIFY(!loaded.matches(text + QLatin1Char(' '), true, 25, false, true));
+    QVERIFY(!loaded.matches(text, false, 25, false, true));
+    QVERIFY(!loaded.matches(text, true, 40, false, true));
+    QVERIFY(!loaded.matches(text, true, 25, true, true));
+    QVERIFY(!loaded.matches(text, true, 25, false, false));
+
+    // Missing and broken files load as empty
+    QVERIFY(QrCodeSnapshot::load(path + QLatin1String(".none")).isEmpty());
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    QVERIFY(file.write("QRCS", 4) == 4);
+    file.close();
+    QVERIFY(QrCodeSnapshot::load(path).isEmpty());
+}
+
+void
+BenchQrClip::fileNames()
+{
+    static const char* const existing[] = {
+        "names.png", "names-007.png", "names-x.png", "namesake.png"
+    };
+
+    // Files left behind by someone else, only two of them count
+    const QString subDir(BENCH_GALLERY_SUBDIR "/names");
+    const QString dir(QStandardPaths::writableLocation(QStandardPaths::PicturesLocation) +
+        QDir::separator() + subDir + QDir::separator());
+    const QrCodeRegistry::Ref code(QrCodeGenerator::generate(QString("names"),
+        HarbourQrCodeGenerator::ECLevel_L));
+    FileUtils fileUtils;
+
+    QDir(dir).removeRecursively();
+    QVERIFY(QDir().mkpath(dir));
+    for (int i = 0; i < BENCH_COUNT(existing); i++) {
+        QFile file(dir + QLatin1String(existing[i]));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+    }
+
+    // The directory is scanned once, then the names are claimed
+    // one after another
+    QCOMPARE(fileUtils.saveToGallery(code.id(), subDir, "names", 1),
+        dir + QLatin1String("names-008.png"));
+    QCOMPARE(fileUtils.saveToGallery(code.id(), subDir, "names", 1),
+        dir + QLatin1String("names-009.png"));
+
+    // The one created behind our back is skipped
+    QFile next(dir + QLatin1String("names-010.png"));
+    QVERIFY(next.open(QIODevice::WriteOnly));
+    next.close();
+    QCOMPARE(fileUtils.saveToGallery(code.id(), subDir, "names", 1),
+        dir + QLatin1String("names-011.png"));
+
+    // Nothing there yet, the first one has no index
+    QCOMPARE(fileUtils.saveToGallery(code.id(), subDir, "fresh", 1),
+        dir + QLatin1String("fresh.png"));
+    QCOMPARE(fileUtils.saveToGallery(code.id(), subDir, "fresh", 1),
+        dir + QLatin1String("fresh-001.png"));
+}
+
+QTEST_GUILESS_MAIN(BenchQrClip)
+
+#include "bench.moc"
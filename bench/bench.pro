@@ -0,0 +1,95 @@
+# Headless benchmarks and unit tests for the encode-to-pixels pipeline.
+#
+# Not built by default, enable with:
+#
+#   qmake CONFIG+=bench harbour-qrclip.pro && make
+#
+# Machine-readable results can be produced with the standard QtTest
+# output options, e.g.
+#
+#   bench/qrclip-bench -o results.xml,xml
+#   bench/qrclip-bench -o results.csv,csv
+
+TEMPLATE = app
+TARGET = qrclip-bench
+CONFIG += link_pkgconfig
+CONFIG -= app_bundle
+PKGCONFIG += zlib
+QT += testlib qml quick concurrent
+
+QMAKE_CXXFLAGS += -Wno-unused-parameter -Wno-psabi
+
+CONFIG(debug, debug|release) {
+    DEFINES += DEBUG HARBOUR_DEBUG
+}
+
+# Directories
+APP_DIR = $${_PRO_FILE_PWD_}/..
+APP_SRC = $${APP_DIR}/src
+HARBOUR_LIB_DIR = $${APP_DIR}/harbour-lib
+HARBOUR_LIB_INCLUDE = $${HARBOUR_LIB_DIR}/include
+HARBOUR_LIB_SRC = $${HARBOUR_LIB_DIR}/src
+LIBQRENCODE_DIR = $${APP_DIR}/libqrencode
+LIBQRENCODE_EXT_DIR = $${APP_DIR}/qrencode
+
+# Libraries (built next to this directory by qrencode.pro)
+LIBS += $${OUT_PWD}/../libqrencode.a -ldl
+PRE_TARGETDEPS += $${OUT_PWD}/../libqrencode.a
+
+INCLUDEPATH += \
+    $${APP_SRC} \
+    $${HARBOUR_LIB_INCLUDE} \
+    $${LIBQRENCODE_DIR} \
+    $${LIBQRENCODE_EXT_DIR}
+
+# Must match the qrencode.pro configuration
+qrencode_scalar_mask {
+    DEFINES += QRCLIP_SCALAR_MASK
+}
+qrencode_scalar_rsecc {
+    DEFINES += QRCLIP_SCALAR_RSECC
+}
+
+SOURCES += \
+    bench.cpp
+
+# Everything except main.cpp, which depends on sailfishapp
+
+HEADERS += \
+    $${APP_SRC}/FileUtils.h \
+    $${APP_SRC}/QrCodeArena.h \
+    $${APP_SRC}/QrCodeCache.h \
+    $${APP_SRC}/QrCodeGenerator.h \
+    $${APP_SRC}/QrCodeHistoryModel.h \
+    $${APP_SRC}/QrCodeImageProvider.h \
+    $${APP_SRC}/QrCodeModel.h \
+    $${APP_SRC}/QrCodeRegistry.h \
+    $${APP_SRC}/QrCodeScheduler.h \
+    $${APP_SRC}/QrCodeSnapshot.h \
+    $${APP_SRC}/QrCodeTrace.h
+
+SOURCES += \
+    $${APP_SRC}/FileUtils.cpp \
+    $${APP_SRC}/QrCodeArena.cpp \
+    $${APP_SRC}/QrCodeCache.cpp \
+    $${APP_SRC}/QrCodeGenerator.cpp \
+    $${APP_SRC}/QrCodeHistoryModel.cpp \
+    $${APP_SRC}/QrCodeImageProvider.cpp \
+    $${APP_SRC}/QrCodeModel.cpp \
+    $${APP_SRC}/QrCodeRegistry.cpp \
+    $${APP_SRC}/QrCodeScheduler.cpp \
+    $${APP_SRC}/QrCodeSnapshot.cpp \
+    $${APP_SRC}/QrCodeTrace.cpp
+
+# harbour-lib
+
+HEADERS += \
+    $${HARBOUR_LIB_INCLUDE}/HarbourBase32.h \
+    $${HARBOUR_LIB_INCLUDE}/HarbourDebug.h \
+    $${HARBOUR_LIB_INCLUDE}/HarbourQrCodeGenerator.h \
+    $${HARBOUR_LIB_INCLUDE}/HarbourTask.h
+
+SOURCES += \
+    $${HARBOUR_LIB_SRC}/HarbourBase32.cpp \
+    $${HARBOUR_LIB_SRC}/HarbourQrCodeGenerator.cpp \
+    $${HARBOUR_LIB_SRC}/HarbourTask.cpp
@@ -7,4 +7,11 @@ app.depends = qrencode-target
 qrencode.file = qrencode.pro
 qrencode.target = qrencode-target
 
+# qmake CONFIG+=bench
+bench {
+    SUBDIRS += qrclip_bench
+    qrclip_bench.file = bench/bench.pro
+    qrclip_bench.depends = qrencode-target
+}
+
 OTHER_FILES += README.md LICENSE rpm/*.spec
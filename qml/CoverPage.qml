@@ -42,9 +42,11 @@ CoverBackground {
 
         Image {
             anchors.fill: parent
+            sourceSize: Qt.size(width, height)
+            fillMode: Image.Pad
             smooth: false
             asynchronous: true
-            source: model.qrcode ? "image://qrcode/" + model.qrcode + "?color=" + Theme.primaryColor : ""
+            source: model.qrcode ? "image://qrcode/" + model.qrcode + "?color=" + Theme.primaryColor + "&margin=1" : ""
             visible: opacity > 0
             opacity: model.qrcode ? 1 : 0
             Behavior on opacity { FadeAnimation { } }
@@ -0,0 +1,100 @@
+import QtQuick 2.0
+import Sailfish.Silica 1.0
+import harbour.qrclip 1.0
+
+Page {
+    id: page
+
+    property alias model: list.model
+
+    SilicaListView {
+        id: list
+
+        anchors.fill: parent
+
+        header: PageHeader {
+            //: Page header
+            //% "History"
+            title: qsTrId("qrclip-history-header")
+        }
+
+        PullDownMenu {
+            MenuItem {
+                //: Pulley menu item
+                //% "Clear history"
+                text: qsTrId("qrclip-history-menu-clear")
+                onClicked: list.model.clear()
+            }
+        }
+
+        delegate: ListItem {
+            id: item
+
+            contentHeight: thumbnailSize + 2 * Theme.paddingMedium
+
+            readonly property int thumbnailSize: Theme.itemSizeLarge
+
+            Rectangle {
+                id: thumbnail
+
+                x: Theme.horizontalPageMargin
+                anchors.verticalCenter: parent.verticalCenter
+                width: item.thumbnailSize
+                height: item.thumbnailSize
+                color: "white"
+                radius: Theme.paddingSmall
+
+                Image {
+                    anchors.centerIn: parent
+                    // Rendered lazily, only for the visible rows
+                    asynchronous: true
+                    source: "image://qrcode/" + model.qrcode + "?margin=1"
+                    sourceSize: Qt.size(item.thumbnailSize, item.thumbnailSize)
+                    smooth: false
+                }
+            }
+
+            Label {
+                anchors {
+                    left: thumbnail.right
+                    leftMargin: Theme.paddingLarge
+                    right: parent.right
+                    rightMargin: Theme.horizontalPageMargin
+                    verticalCenter: parent.verticalCenter
+                }
+                text: model.text
+                maximumLineCount: 3
+                wrapMode: Text.Wrap
+                elide: Text.ElideRight
+                font.pixelSize: Theme.fontSizeSmall
+                color: item.highlighted ? Theme.highlightColor : Theme.primaryColor
+            }
+
+            menu: Component {
+                ContextMenu {
+                    MenuItem {
+                        //: Context menu item
+                        //% "Remove"
+                        text: qsTrId("qrclip-history-menu-remove")
+                        onClicked: item.remorseDelete(function() { list.model.remove(index) })
+                    }
+                }
+            }
+
+            onClicked: {
+                // Putting the text back to the clipboard makes it current
+                HarbourClipboard.text = model.text
+                pageStack.pop()
+            }
+        }
+
+        ViewPlaceholder {
+            enabled: !list.count
+            //: Placeholder text
+            //% "History is empty."
+            text: qsTrId("qrclip-history-placeholder")
+        }
+
+        VerticalScrollDecorator { }
+    }
+}
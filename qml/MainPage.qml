@@ -9,6 +9,7 @@ Page {
     id: page
 
     property alias model: qrCodes.model
+    property var history
 
     property alias _showText: showText.value
     property real _spaceForText: _showText ? _maxSpaceForText : _minSpaceForText
@@ -25,33 +26,77 @@ Page {
         PullDownMenu {
             id: menu
 
-            visible: _haveQrCode && _showText
+            visible: _showText && (_haveQrCode || (history && history.count > 0))
 
+            property int saveId
+            property string savingQrCode
             property string savedQrCode
 
-            onActiveChanged: {
+            function applySavedQrCode() {
                 if (!active && savedQrCode && _currentItem) {
                     // Don't save the same code twice
-                    _currentItem.lastSavedQrCode = savedQrCode
+                    if (_currentItem.firstQrCode === savedQrCode) {
+                        _currentItem.lastSavedQrCode = savedQrCode
+                    }
                     savedQrCode = ""
                 }
             }
 
+            onActiveChanged: applySavedQrCode()
+
+            MenuItem {
+                //: Pulley menu item
+                //% "History"
+                text: qsTrId("qrclip-menu-history")
+                visible: history && history.count > 0
+                onClicked: pageStack.push(Qt.resolvedUrl("HistoryPage.qml"), {
+                    allowedOrientations: page.allowedOrientations,
+                    model: history
+                })
+            }
             MenuItem {
                 //: Pulley menu item
                 //% "Save to Gallery"
                 text: qsTrId("qrclip-menu-save_to_gallery")
                 visible: _currentItem && _currentItem.needToSaveImage
                 onClicked: {
-                    if (_currentItem && FileUtils.saveToGallery(_currentItem.qrCode, "QRClip", "qrcode", Math.min(_currentItem.qrCodeScale, 5))) {
-                        menu.savedQrCode = _currentItem.qrCode
+                    if (_currentItem) {
+                        // Structured append symbols are saved together
+                        var scale = Math.min(_currentItem.qrCodeScale, 5)
+                        // The code is marked as saved when it's actually saved
+                        menu.savingQrCode = _currentItem.firstQrCode
+                        menu.saveId = (_currentItem.symbolCount > 1) ?
+                            FileUtils.saveAllToGallery(_currentItem.sequence, "QRClip", "qrcode", scale) :
+                            FileUtils.saveToGalleryAsync(_currentItem.qrCode, "QRClip", "qrcode", scale)
                     }
                 }
             }
             MenuLabel {
-                //: Pulley menu label
-                //% "Level %1"
-                text: _currentItem ? qsTrId("qrclip-menu-level").arg(_currentItem.ecLevel) : ""
+                text: !_currentItem ? "" : _currentItem.micro ?
+                    //: Pulley menu label
+                    //% "Micro QR, level %1"
+                    qsTrId("qrclip-menu-micro_level").arg(_currentItem.ecLevel) :
+                    //: Pulley menu label
+                    //% "Level %1"
+                    qsTrId("qrclip-menu-level").arg(_currentItem.ecLevel)
+                visible: !!_currentItem
+            }
+        }
+
+        Connections {
+            target: FileUtils
+            onSaveFinished: {
+                if (requestId === menu.saveId) {
+                    menu.saveId = 0
+                    if (paths.length > 0 && paths.indexOf("") < 0) {
+                        menu.savedQrCode = menu.savingQrCode
+                        menu.applySavedQrCode()
+                    } else {
+                        console.warn(error)
+                        saveError.show()
+                    }
+                    menu.savingQrCode = ""
+                }
             }
         }
 
@@ -72,9 +117,16 @@ Page {
                 height: qrCodes.height
 
                 property string lastSavedQrCode
-                readonly property string qrCode: model.qrcode
-                readonly property bool needToSaveImage: qrCode !== lastSavedQrCode
-                readonly property int qrCodeScale: qrcodeImage.n
+                property int symbol
+                readonly property bool current: ListView.isCurrentItem
+                readonly property var sequence: model.sequence
+                readonly property int symbolCount: sequence ? sequence.length : 0
+                readonly property string qrCode: symbolCount > 1 ? sequence[symbol % symbolCount] : model.qrcode
+                readonly property bool pending: model.pending
+                readonly property bool micro: model.micro
+                readonly property string firstQrCode: model.qrcode
+                readonly property bool needToSaveImage: firstQrCode !== lastSavedQrCode && !pending
+                readonly property int qrCodeScale: model.modules ? Math.floor(_maxDisplaySize/model.modules) : 0
                 readonly property var ecLevel: {
                     switch (model.eclevel) {
                     case HarbourQrCodeGenerator.ECLevel_L: return "L"
@@ -102,7 +154,7 @@ Page {
                         anchors.centerIn: parent
                         width: qrcodeImage.width + 2 * Theme.horizontalPageMargin
                         height: qrcodeImage.height + 2 * Theme.horizontalPageMargin
-                        opacity: (qrcodeImage.width && qrcodeImage.height) ? 1 : 0
+                        opacity: (qrcodeImage.width && qrcodeImage.height) ? (pending ? 0.4 : 1) : 0
 
                         readonly property int margins: Math.round((Math.min(qrCodes.width, qrCodes.height) - Math.max(width, height))/2)
 
@@ -111,17 +163,34 @@ Page {
 
                             asynchronous: true
                             anchors.centerIn: parent
-                            source: "image://qrcode/" + model.qrcode
-                            width: sourceSize.width * n
-                            height: sourceSize.height * n
+                            source: "image://qrcode/" + qrCode
+                            // Rendered at the final size by the provider
+                            sourceSize: Qt.size(_maxDisplaySize, _maxDisplaySize)
                             smooth: false
-
-                            readonly property int maxSourceSize: Math.max(sourceSize.width, sourceSize.height)
-                            readonly property int n: maxSourceSize ? Math.floor(_maxDisplaySize/maxSourceSize) : 0
                         }
                     }
                 }
 
+                Label {
+                    anchors {
+                        top: parent.top
+                        topMargin: Theme.paddingLarge
+                        horizontalCenter: parent.horizontalCenter
+                    }
+                    visible: symbolCount > 1
+                    text: (symbol % symbolCount + 1) + "/" + symbolCount
+                    color: Theme.highlightColor
+                    font.pixelSize: Theme.fontSizeLarge
+                }
+
+                Timer {
+                    // Structured append symbols are shown one after another
+                    interval: 1000
+                    repeat: true
+                    running: symbolCount > 1 && Qt.application.active && current
+                    onTriggered: symbol = (symbol + 1) % symbolCount
+                }
+
                 onClicked: _showText = !_showText
             }
         }
@@ -181,6 +250,37 @@ Page {
         }
     }
 
+    Label {
+        id: saveError
+
+        anchors {
+            bottom: parent.bottom
+            bottomMargin: Theme.paddingLarge
+            horizontalCenter: parent.horizontalCenter
+        }
+        width: parent.width - 2 * Theme.horizontalPageMargin
+        horizontalAlignment: Text.AlignHCenter
+        wrapMode: Text.Wrap
+        color: Theme.highlightColor
+        //: Error message
+        //% "Failed to save the image."
+        text: qsTrId("qrclip-error-save_failed")
+        opacity: saveErrorTimer.running ? 1 : 0
+        visible: opacity > 0
+
+        function show() {
+            saveErrorTimer.restart()
+        }
+
+        Timer {
+            id: saveErrorTimer
+
+            interval: 3000
+        }
+
+        Behavior on opacity { FadeAnimation { } }
+    }
+
     Behavior on _spaceForText { SmoothedAnimation { duration: 200 } }
 
     states: [
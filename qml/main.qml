@@ -1,5 +1,6 @@
 import QtQuick 2.0
 import Sailfish.Silica 1.0
+import org.nemomobile.configuration 1.0
 import harbour.qrclip 1.0
 
 ApplicationWindow {
@@ -10,6 +11,7 @@ ApplicationWindow {
         MainPage {
             allowedOrientations: appWindow.allowedOrientations
             model: qrcodes
+            history: qrhistory
         }
     }
     cover: Component {
@@ -22,5 +24,45 @@ ApplicationWindow {
         id: qrcodes
 
         text: HarbourClipboard.text
+        structuredAppend: structuredAppendConfig.value
+        maxVersion: maxVersionConfig.value
+        microQr: microQrConfig.value
+        optimalSegmentation: optimalSegmentationConfig.value
+        // The cover is visible too, but it's not that important
+        priority: Qt.application.active ? QrCodeModel.HighPriority : QrCodeModel.NormalPriority
+    }
+
+    QrCodeHistoryModel {
+        id: qrhistory
+
+        source: qrcodes
+    }
+
+    ConfigurationValue {
+        id: maxVersionConfig
+
+        key: "/apps/harbour-qrclip/maxVersion"
+        defaultValue: 40
+    }
+
+    ConfigurationValue {
+        id: structuredAppendConfig
+
+        key: "/apps/harbour-qrclip/structuredAppend"
+        defaultValue: false
+    }
+
+    ConfigurationValue {
+        id: microQrConfig
+
+        key: "/apps/harbour-qrclip/microQr"
+        defaultValue: false
+    }
+
+    ConfigurationValue {
+        id: optimalSegmentationConfig
+
+        key: "/apps/harbour-qrclip/optimalSegmentation"
+        defaultValue: false
     }
 }
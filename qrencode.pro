@@ -4,6 +4,9 @@ TARGET = qrencode
 QT-= gui
 
 SRC_DIR = $${_PRO_FILE_PWD_}/libqrencode
+EXT_DIR = $${_PRO_FILE_PWD_}/qrencode
+
+INCLUDEPATH += $${SRC_DIR}
 
 MAJOR_VERSION = 4
 MINOR_VERSION = 1
@@ -11,6 +14,7 @@ MICRO_VERSION = 1
 
 DEFINES += \
     STATIC_IN_RELEASE=static \
+    HAVE_LIBPTHREAD=1 \
     MAJOR_VERSION=$${MAJOR_VERSION} \
     MINOR_VERSION=$${MINOR_VERSION} \
     MICRO_VERSION=$${MICRO_VERSION} \
@@ -18,11 +22,38 @@ DEFINES += \
 
 SOURCES += \
     $${SRC_DIR}/bitstream.c \
-    $${SRC_DIR}/mask.c \
     $${SRC_DIR}/mmask.c \
     $${SRC_DIR}/mqrspec.c \
-    $${SRC_DIR}/rsecc.c \
     $${SRC_DIR}/split.c \
     $${SRC_DIR}/qrencode.c \
     $${SRC_DIR}/qrinput.c \
-    $${SRC_DIR}/qrspec.c
+    $${SRC_DIR}/qrspec.c \
+    $${EXT_DIR}/qralloc.c \
+    $${EXT_DIR}/qrclip.c
+
+# The encoder allocates from a per-thread arena, see qrclip.h
+QMAKE_CFLAGS += -include $${EXT_DIR}/qralloc.h
+
+# Bit-parallel mask evaluation. The original implementation can be
+# built with qmake CONFIG+=qrencode_scalar_mask and the two can be
+# cross-checked at runtime with qmake CONFIG+=qrencode_verify_mask
+qrencode_scalar_mask {
+    SOURCES += $${SRC_DIR}/mask.c
+} else {
+    SOURCES += $${EXT_DIR}/mask.c
+    qrencode_verify_mask {
+        DEFINES += QRCLIP_VERIFY_MASK
+    }
+}
+
+# Table-driven Reed-Solomon encoder. The original one can be
+# built with qmake CONFIG+=qrencode_scalar_rsecc
+qrencode_scalar_rsecc {
+    SOURCES += $${SRC_DIR}/rsecc.c
+} else {
+    SOURCES += $${EXT_DIR}/rsecc.c
+}
+
+HEADERS += \
+    $${EXT_DIR}/qralloc.h \
+    $${EXT_DIR}/qrclip.h
@@ -0,0 +1,573 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+/*
+ * Bit-parallel replacement for Mask_mask() from libqrencode/mask.c
+ *
+ * The original code applies each of the 8 mask patterns to a copy of
+ * the frame (one byte per module) and then walks that copy several
+ * times to calculate the N1..N3 penalties. Here each row and column
+ * of the symbol is packed into a few 64-bit words instead. The masked
+ * rows and columns are produced with a handful of word operations and
+ * penalties are calculated with popcount and by walking the run
+ * boundaries. Only the winning pattern is applied to the byte frame,
+ * by the original code, so the output is exactly the same.
+ *
+ * Each mask trial is a cancellation checkpoint, see QRclip_isCanceled()
+ * For large symbols the trials may also be run in parallel, each one
+ * with its own scratch symbol, see QRclip_setParallelFunc()
+ *
+ * The upstream file is compiled as a part of this one, with its
+ * Mask_mask() renamed. That keeps its static helpers available here
+ * and makes it easy to compare the results.
+ */
+
+#define Mask_mask Mask_maskScalar
+#include "../libqrencode/mask.c"
+#undef Mask_mask
+
+#include "qrclip.h"
+
+#include <errno.h>
+#include <stdint.h>
+#ifdef QRCLIP_VERIFY_MASK
+#  include <stdio.h>
+#endif
+#ifdef HAVE_LIBPTHREAD
+#  include <pthread.h>
+#endif
+
+#if !defined(QRSPEC_WIDTH_MAX) || QRSPEC_WIDTH_MAX > 192
+#  error "Unexpected QRSPEC_WIDTH_MAX"
+#endif
+
+#define QRSPEC_VERSION_OF_WIDTH(w) (((w) - 17) / 4)
+
+#define WORD_BITS (64)
+#define WORDS ((QRSPEC_WIDTH_MAX + WORD_BITS - 1) / WORD_BITS)
+
+/* Mask patterns repeat every 12 rows and every 6 columns */
+#define ROW_PERIOD (12)
+#define COL_PERIOD (6)
+
+typedef uint64_t MaskWord;
+typedef MaskWord MaskLine[WORDS];
+
+typedef struct mask_frame {
+    int width;
+    MaskWord keep[WORDS];            /* Bits 0..width-1 */
+    MaskWord valid[WORDS];           /* Bits 1..width-1 */
+    MaskLine data[QRSPEC_WIDTH_MAX]; /* Rows */
+    MaskLine dataT[QRSPEC_WIDTH_MAX];/* Columns */
+    MaskLine func[QRSPEC_WIDTH_MAX]; /* Function modules, not masked */
+    MaskLine funcT[QRSPEC_WIDTH_MAX];
+} MaskFrame;
+
+typedef struct mask_symbol {
+    MaskLine row[QRSPEC_WIDTH_MAX];
+    MaskLine col[QRSPEC_WIDTH_MAX];
+} MaskSymbol;
+
+static MaskLine maskRow[maskNum][ROW_PERIOD];
+static MaskLine maskCol[maskNum][COL_PERIOD];
+#ifdef HAVE_LIBPTHREAD
+static pthread_once_t maskPatternsOnce = PTHREAD_ONCE_INIT;
+#else
+static int maskPatternsReady = 0;
+#endif
+
+static
+inline
+int
+mask_popcount(
+    MaskWord w)
+{
+#ifdef __GNUC__
+    return __builtin_popcountll(w);
+#else
+    int n = 0;
+
+    while (w) {
+        w &= w - 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static
+inline
+int
+mask_ctz(
+    MaskWord w)
+{
+#ifdef __GNUC__
+    return __builtin_ctzll(w);
+#else
+    int n = 0;
+
+    while (!(w & 1)) {
+        w >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static
+inline
+int
+mask_bit(
+    const MaskWord* line,
+    int i)
+{
+    return (int)((line[i / WORD_BITS] >> (i % WORD_BITS)) & 1);
+}
+
+static
+inline
+void
+mask_set_bit(
+    MaskWord* line,
+    int i,
+    int value)
+{
+    const MaskWord bit = ((MaskWord)1) << (i % WORD_BITS);
+
+    if (value) {
+        line[i / WORD_BITS] |= bit;
+    } else {
+        line[i / WORD_BITS] &= ~bit;
+    }
+}
+
+static
+int
+mask_pattern(
+    int i,
+    int x,
+    int y)
+{
+    /* Same expressions as in the MASKMAKER() calls in mask.c */
+    switch (i) {
+    case 0: return ((x+y)&1) == 0;
+    case 1: return (y&1) == 0;
+    case 2: return (x%3) == 0;
+    case 3: return ((x+y)%3) == 0;
+    case 4: return (((y/2)+(x/3))&1) == 0;
+    case 5: return (((x*y)&1)+(x*y)%3) == 0;
+    case 6: return ((((x*y)&1)+(x*y)%3)&1) == 0;
+    case 7: return ((((x*y)%3)+((x+y)&1))&1) == 0;
+    }
+    return 0;
+}
+
+static
+void
+mask_build_patterns(
+    void)
+{
+    int i, x, y;
+
+    /* The tables are zero-initialized, only the set bits are written */
+    for (i = 0; i < maskNum; i++) {
+        for (y = 0; y < ROW_PERIOD; y++) {
+            for (x = 0; x < WORDS * WORD_BITS; x++) {
+                if (mask_pattern(i, x, y)) {
+                    mask_set_bit(maskRow[i][y], x, 1);
+                }
+            }
+        }
+        for (x = 0; x < COL_PERIOD; x++) {
+            for (y = 0; y < WORDS * WORD_BITS; y++) {
+                if (mask_pattern(i, x, y)) {
+                    mask_set_bit(maskCol[i][x], y, 1);
+                }
+            }
+        }
+    }
+}
+
+static
+void
+mask_init_patterns(
+    void)
+{
+    /*
+     * Mask trials for different levels run on several threads at once.
+     * The tables are built exactly once, and pthread_once() makes them
+     * visible to every thread which gets past it. Nobody reads them
+     * while they are being written.
+     */
+#ifdef HAVE_LIBPTHREAD
+    pthread_once(&maskPatternsOnce, mask_build_patterns);
+#else
+    if (!maskPatternsReady) {
+        mask_build_patterns();
+        maskPatternsReady = 1;
+    }
+#endif
+}
+
+static
+void
+mask_frame_init(
+    MaskFrame* f,
+    int width,
+    const unsigned char* frame)
+{
+    int x, y;
+    const unsigned char* p = frame;
+
+    memset(f, 0, sizeof(*f));
+    f->width = width;
+    for (x = 0; x < width; x++) {
+        mask_set_bit(f->keep, x, 1);
+        mask_set_bit(f->valid, x, x > 0);
+    }
+    for (y = 0; y < width; y++) {
+        for (x = 0; x < width; x++, p++) {
+            if (*p & 0x80) {
+                mask_set_bit(f->func[y], x, 1);
+                mask_set_bit(f->funcT[x], y, 1);
+            }
+            if (*p & 1) {
+                mask_set_bit(f->data[y], x, 1);
+                mask_set_bit(f->dataT[x], y, 1);
+            }
+        }
+    }
+}
+
+/* Applies the mask pattern, returns the number of dark modules */
+static
+int
+mask_apply(
+    const MaskFrame* f,
+    MaskSymbol* s,
+    int mask)
+{
+    const int width = f->width;
+    int i, k, blacks = 0;
+
+    for (i = 0; i < width; i++) {
+        const MaskWord* r = maskRow[mask][i % ROW_PERIOD];
+        const MaskWord* c = maskCol[mask][i % COL_PERIOD];
+
+        /* Function modules are copied as is, like MASKMAKER() does */
+        for (k = 0; k < WORDS; k++) {
+            s->row[i][k] = (f->data[i][k] ^ (r[k] & ~f->func[i][k])) & f->keep[k];
+            s->col[i][k] = (f->dataT[i][k] ^ (c[k] & ~f->funcT[i][k])) & f->keep[k];
+            blacks += mask_popcount(s->row[i][k]);
+        }
+    }
+    return blacks;
+}
+
+static
+inline
+void
+mask_set_module(
+    MaskSymbol* s,
+    int x,
+    int y,
+    int value)
+{
+    mask_set_bit(s->row[y], x, value);
+    mask_set_bit(s->col[x], y, value);
+}
+
+/* Mirrors Mask_writeFormatInformation() */
+static
+int
+mask_write_format(
+    MaskSymbol* s,
+    int width,
+    int mask,
+    QRecLevel level)
+{
+    unsigned int format = QRspec_getFormatInfo(mask, level);
+    int i, v, blacks = 0;
+
+    for (i = 0; i < 8; i++) {
+        v = format & 1;
+        blacks += v ? 2 : 0;
+        mask_set_module(s, width - 1 - i, 8, v);
+        if (i < 6) {
+            mask_set_module(s, 8, i, v);
+        } else {
+            mask_set_module(s, 8, i + 1, v);
+        }
+        format = format >> 1;
+    }
+    for (i = 0; i < 7; i++) {
+        v = format & 1;
+        blacks += v ? 2 : 0;
+        mask_set_module(s, 8, width - 7 + i, v);
+        if (i == 0) {
+            mask_set_module(s, 7, 8, v);
+        } else {
+            mask_set_module(s, 6 - i, 8, v);
+        }
+        format = format >> 1;
+    }
+    return blacks;
+}
+
+/* Bit x of the result is bit x-1 of the line */
+static
+inline
+MaskWord
+mask_shift(
+    const MaskWord* line,
+    int k)
+{
+    return (line[k] << 1) | (k ? (line[k - 1] >> (WORD_BITS - 1)) : 0);
+}
+
+/* Same as Mask_calcN2() */
+static
+int
+mask_n2(
+    const MaskFrame* f,
+    const MaskSymbol* s)
+{
+    int y, k, n = 0;
+
+    for (y = 1; y < f->width; y++) {
+        const MaskWord* a = s->row[y - 1];
+        const MaskWord* b = s->row[y];
+
+        for (k = 0; k < WORDS; k++) {
+            const MaskWord same = ~(a[k] ^ mask_shift(a, k)) &
+                ~(b[k] ^ mask_shift(b, k)) & ~(a[k] ^ b[k]);
+
+            n += mask_popcount(same & f->valid[k]);
+        }
+    }
+    return n * N2;
+}
+
+/* Same as Mask_calcRunLengthH() but walks the run boundaries */
+static
+int
+mask_run_length(
+    const MaskFrame* f,
+    const MaskWord* line,
+    int* runLength)
+{
+    int k, start = 0, head = 0;
+
+    if (line[0] & 1) {
+        runLength[head++] = -1;
+    }
+    for (k = 0; k < WORDS; k++) {
+        MaskWord t = (line[k] ^ mask_shift(line, k)) & f->valid[k];
+
+        while (t) {
+            const int x = k * WORD_BITS + mask_ctz(t);
+
+            runLength[head++] = x - start;
+            start = x;
+            t &= t - 1;
+        }
+    }
+    runLength[head++] = f->width - start;
+    return head;
+}
+
+static
+int
+mask_evaluate(
+    const MaskFrame* f,
+    const MaskSymbol* s)
+{
+    int i, demerit = mask_n2(f, s);
+    int runLength[QRSPEC_WIDTH_MAX + 1];
+
+    for (i = 0; i < f->width; i++) {
+        demerit += Mask_calcN1N3(mask_run_length(f, s->row[i], runLength),
+            runLength);
+    }
+    for (i = 0; i < f->width; i++) {
+        demerit += Mask_calcN1N3(mask_run_length(f, s->col[i], runLength),
+            runLength);
+    }
+    return demerit;
+}
+
+/* Full penalty of the pattern, including N4 */
+static
+int
+mask_demerit(
+    const MaskFrame* f,
+    MaskSymbol* s,
+    int mask,
+    QRecLevel level)
+{
+    const int w2 = f->width * f->width;
+    const int blacks = mask_apply(f, s, mask) +
+        mask_write_format(s, f->width, mask, level);
+    const int bratio = (200 * blacks + w2) / w2 / 2;
+
+    return (abs(bratio - 50) / 5) * N4 + mask_evaluate(f, s);
+}
+
+/* State shared by the parallel trials, the frame is read-only */
+typedef struct mask_trials {
+    const MaskFrame* frame;
+    QRecLevel level;
+    int demerit[maskNum];
+} MaskTrials;
+
+static
+void
+mask_trial(
+    void* data,
+    int mask)
+{
+    MaskTrials* t = data;
+    MaskSymbol* s = malloc(sizeof(MaskSymbol));
+
+    if (s) {
+        t->demerit[mask] = mask_demerit(t->frame, s, mask, t->level);
+        free(s);
+    } else {
+        t->demerit[mask] = -1;
+    }
+}
+
+unsigned char*
+Mask_mask(
+    int width,
+    unsigned char* frame,
+    QRecLevel level)
+{
+    int i, best = 0, minDemerit = INT_MAX;
+    MaskFrame* f = malloc(sizeof(MaskFrame) + sizeof(MaskSymbol));
+    MaskSymbol* s;
+    MaskTrials t;
+    unsigned char* masked;
+
+    if (!f) return NULL;
+    s = (MaskSymbol*)(f + 1);
+
+    mask_init_patterns();
+    mask_frame_init(f, width, frame);
+
+    t.frame = f;
+    t.level = level;
+    if (!QRclip_isCanceled() &&
+        QRclip_runParallel(QRSPEC_VERSION_OF_WIDTH(width), mask_trial,
+            &t, maskNum)) {
+        /* Checked once for all trials */
+        for (i = 0; i < maskNum && t.demerit[i] >= 0; i++);
+        if (i < maskNum || QRclip_isCanceled()) {
+            free(f);
+            errno = (i < maskNum) ? ENOMEM : ECANCELED;
+            return NULL;
+        }
+    } else {
+        for (i = 0; i < maskNum; i++) {
+            if (QRclip_isCanceled()) {
+                /* QRcode_encodeMask() fails if there's no masked frame */
+                free(f);
+                errno = ECANCELED;
+                return NULL;
+            }
+            t.demerit[i] = mask_demerit(f, s, i, level);
+        }
+    }
+    free(f);
+
+    /* The first one wins in case of a tie, same as in the original */
+    for (i = 0; i < maskNum; i++) {
+        if (t.demerit[i] < minDemerit) {
+            minDemerit = t.demerit[i];
+            best = i;
+        }
+    }
+
+#ifdef QRCLIP_VERIFY_MASK
+    if (QRclip_verifyMask(width, frame, level)) {
+        fprintf(stderr, "Mask penalty mismatch (width %d)\n", width);
+        abort();
+    }
+#endif
+
+    /* Let the original code produce the output */
+    masked = Mask_makeMask(width, frame, best, level);
+    return masked;
+}
+
+int
+QRclip_verifyMask(
+    int width,
+    unsigned char* frame,
+    QRecLevel level)
+{
+    int i, mismatches = 0;
+    const int w2 = width * width;
+    MaskFrame* f = malloc(sizeof(MaskFrame) + sizeof(MaskSymbol));
+    unsigned char* mask = malloc(w2);
+
+    if (f && mask) {
+        MaskSymbol* s = (MaskSymbol*)(f + 1);
+
+        mask_init_patterns();
+        mask_frame_init(f, width, frame);
+        for (i = 0; i < maskNum; i++) {
+            /* Mirrors the loop in the original Mask_mask() */
+            int blacks = maskMakers[i](width, frame, mask);
+            int bratio, demerit;
+
+            blacks += Mask_writeFormatInformation(width, mask, i, level);
+            bratio = (200 * blacks + w2) / w2 / 2;
+            demerit = (abs(bratio - 50) / 5) * N4;
+            demerit += Mask_evaluateSymbol(width, mask);
+            if (demerit != mask_demerit(f, s, i, level)) {
+                mismatches++;
+            }
+        }
+    } else {
+        mismatches = -1;
+    }
+    free(mask);
+    free(f);
+    return mismatches;
+}
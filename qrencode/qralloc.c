@@ -0,0 +1,422 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "qralloc.h"
+#include "qrclip.h"
+
+#ifdef HAVE_LIBPTHREAD
+#  include <pthread.h>
+#endif
+
+/* This is where the allocations actually hit the heap */
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+#undef strdup
+
+#define ARENA_ALIGN (16)
+#define ARENA_ROUND(n) (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+#define ARENA_MAX_BLOCK ((size_t)-1 / 4)
+
+/* The first chunk, then each one is twice as big as the previous */
+#define ARENA_MIN_CHUNK (16 * 1024)
+
+/* Anything bigger than that is given back at the end of the scope */
+#define ARENA_MAX_KEEP (1024 * 1024)
+
+/* Each block is preceded by its size, padded to keep the alignment */
+#define ARENA_HEADER ARENA_ROUND(sizeof(size_t))
+#define ARENA_BLOCK_SIZE(p) (*(size_t*)((unsigned char*)(p) - ARENA_HEADER))
+
+typedef struct qrclip_arena_chunk {
+    struct qrclip_arena_chunk* next;
+    size_t size;
+    size_t used;
+} QRclipArenaChunk;
+
+#define ARENA_CHUNK_DATA(c) \
+    ((unsigned char*)(c) + ARENA_ROUND(sizeof(QRclipArenaChunk)))
+
+typedef struct qrclip_arena {
+    QRclipArenaChunk* chunks;   /* The current one comes first */
+    unsigned char* last;        /* The last block, resizable in place */
+    size_t used;                /* Total for the current scope */
+    int depth;
+} QRclipArena;
+
+/* Per-thread arena (allocated on demand) and statistics */
+static __thread QRclipArena* qrclipArena = NULL;
+static __thread QRclipAllocStats qrclipAllocStats;
+
+#ifdef HAVE_LIBPTHREAD
+/* Frees the arena when the thread exits */
+static pthread_key_t qrclipArenaKey;
+static pthread_once_t qrclipArenaKeyOnce = PTHREAD_ONCE_INIT;
+#endif
+
+static
+void
+qrclip_arena_free_chunks(
+    QRclipArenaChunk* c)
+{
+    while (c) {
+        QRclipArenaChunk* next = c->next;
+
+        free(c);
+        c = next;
+    }
+}
+
+#ifdef HAVE_LIBPTHREAD
+
+static
+void
+qrclip_arena_destroy(
+    void* data)
+{
+    QRclipArena* a = data;
+
+    qrclip_arena_free_chunks(a->chunks);
+    free(a);
+}
+
+static
+void
+qrclip_arena_key_init(void)
+{
+    pthread_key_create(&qrclipArenaKey, qrclip_arena_destroy);
+}
+
+#endif /* HAVE_LIBPTHREAD */
+
+static
+QRclipArenaChunk*
+qrclip_arena_chunk_new(
+    size_t size)
+{
+    QRclipArenaChunk* c = malloc(ARENA_ROUND(sizeof(QRclipArenaChunk)) + size);
+
+    if (c) {
+        c->next = NULL;
+        c->size = size;
+        c->used = 0;
+        qrclipAllocStats.heap_allocs++;
+    }
+    return c;
+}
+
+static
+inline
+QRclipArena*
+qrclip_arena_active(void)
+{
+    QRclipArena* a = qrclipArena;
+
+    return (a && a->depth) ? a : NULL;
+}
+
+static
+int
+qrclip_arena_owns(
+    const QRclipArena* a,
+    const void* ptr)
+{
+    const unsigned char* p = ptr;
+    const QRclipArenaChunk* c;
+
+    for (c = a->chunks; c; c = c->next) {
+        const unsigned char* data = ARENA_CHUNK_DATA(c);
+
+        if (p >= data && p < data + c->size) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static
+inline
+void
+qrclip_arena_use(
+    QRclipArena* a,
+    size_t old_total,
+    size_t new_total)
+{
+    a->chunks->used = a->chunks->used - old_total + new_total;
+    a->used = a->used - old_total + new_total;
+    if (qrclipAllocStats.peak_bytes < a->used) {
+        qrclipAllocStats.peak_bytes = a->used;
+    }
+}
+
+static
+void*
+qrclip_arena_alloc(
+    QRclipArena* a,
+    size_t size)
+{
+    QRclipArenaChunk* c = a->chunks;
+    unsigned char* block;
+    size_t total;
+
+    if (size > ARENA_MAX_BLOCK) return NULL;
+    total = ARENA_HEADER + ARENA_ROUND(size);
+    if (!c || c->size - c->used < total) {
+        /* What's left in the current chunk is wasted until the end */
+        size_t chunk_size = c ? (c->size * 2) : ARENA_MIN_CHUNK;
+
+        if (chunk_size < total) chunk_size = total;
+        c = qrclip_arena_chunk_new(chunk_size);
+        if (!c) return NULL;
+        c->next = a->chunks;
+        a->chunks = c;
+    }
+
+    block = ARENA_CHUNK_DATA(c) + c->used;
+    *(size_t*)block = size;
+    qrclip_arena_use(a, 0, total);
+    return (a->last = block + ARENA_HEADER);
+}
+
+static
+void*
+qrclip_arena_realloc(
+    QRclipArena* a,
+    void* ptr,
+    size_t size)
+{
+    const size_t old_size = ARENA_BLOCK_SIZE(ptr);
+    void* copy;
+
+    if (size > ARENA_MAX_BLOCK) return NULL;
+    if (ptr == a->last) {
+        /* The last block can grow (or shrink) in place if there's room */
+        const QRclipArenaChunk* c = a->chunks;
+        const size_t old_total = ARENA_ROUND(old_size);
+        const size_t new_total = ARENA_ROUND(size);
+
+        if (new_total <= old_total || c->size - c->used >= new_total - old_total) {
+            ARENA_BLOCK_SIZE(ptr) = size;
+            qrclip_arena_use(a, old_total, new_total);
+            return ptr;
+        }
+    }
+
+    /* The old block stays where it is until the end of the scope */
+    copy = qrclip_arena_alloc(a, size);
+    if (copy) {
+        memcpy(copy, ptr, (old_size < size) ? old_size : size);
+    }
+    return copy;
+}
+
+static
+void
+qrclip_arena_release(
+    QRclipArena* a,
+    void* ptr)
+{
+    /* Only the last block can actually be given back */
+    if (ptr == a->last) {
+        qrclip_arena_use(a, ARENA_HEADER + ARENA_ROUND(ARENA_BLOCK_SIZE(ptr)), 0);
+        a->last = NULL;
+    }
+}
+
+void
+QRclip_arenaBegin(void)
+{
+    QRclipArena* a = qrclipArena;
+
+    if (!a) {
+        a = calloc(1, sizeof(QRclipArena));
+        if (!a) return;
+        qrclipAllocStats.heap_allocs++;
+#ifdef HAVE_LIBPTHREAD
+        pthread_once(&qrclipArenaKeyOnce, qrclip_arena_key_init);
+        pthread_setspecific(qrclipArenaKey, a);
+#endif
+        qrclipArena = a;
+    }
+    a->depth++;
+}
+
+void
+QRclip_arenaEnd(void)
+{
+    QRclipArena* a = qrclipArena;
+
+    if (a && a->depth > 0 && !--a->depth) {
+        QRclipArenaChunk* c = a->chunks;
+
+        if (c && c->next) {
+            /* Next time it all fits into a single chunk */
+            size_t size = 0;
+
+            for (; c; c = c->next) {
+                size += c->size;
+            }
+            qrclip_arena_free_chunks(a->chunks);
+            a->chunks = (size <= ARENA_MAX_KEEP) ?
+                qrclip_arena_chunk_new(size) : NULL;
+        } else if (c && c->size > ARENA_MAX_KEEP) {
+            qrclip_arena_free_chunks(a->chunks);
+            a->chunks = NULL;
+        } else if (c) {
+            c->used = 0;
+        }
+        a->last = NULL;
+        a->used = 0;
+    }
+}
+
+void
+QRclip_getAllocStats(
+    QRclipAllocStats* stats)
+{
+    *stats = qrclipAllocStats;
+}
+
+void
+QRclip_resetAllocStats(void)
+{
+    memset(&qrclipAllocStats, 0, sizeof(qrclipAllocStats));
+}
+
+void*
+QRclip_malloc(
+    size_t size)
+{
+    QRclipArena* a = qrclip_arena_active();
+
+    qrclipAllocStats.allocs++;
+    if (a) {
+        return qrclip_arena_alloc(a, size);
+    } else {
+        qrclipAllocStats.heap_allocs++;
+        return malloc(size);
+    }
+}
+
+void*
+QRclip_calloc(
+    size_t nmemb,
+    size_t size)
+{
+    QRclipArena* a = qrclip_arena_active();
+
+    qrclipAllocStats.allocs++;
+    if (a) {
+        void* ptr;
+
+        if (size && nmemb > ARENA_MAX_BLOCK / size) return NULL;
+        ptr = qrclip_arena_alloc(a, nmemb * size);
+        if (ptr) {
+            memset(ptr, 0, nmemb * size);
+        }
+        return ptr;
+    } else {
+        qrclipAllocStats.heap_allocs++;
+        return calloc(nmemb, size);
+    }
+}
+
+void*
+QRclip_realloc(
+    void* ptr,
+    size_t size)
+{
+    QRclipArena* a = qrclipArena;
+
+    if (!ptr) {
+        return QRclip_malloc(size);
+    }
+
+    qrclipAllocStats.allocs++;
+    if (a && qrclip_arena_owns(a, ptr)) {
+        if (a->depth) {
+            return qrclip_arena_realloc(a, ptr, size);
+        } else {
+            /* Shouldn't happen, the block has outlived its scope */
+            void* copy = malloc(size);
+
+            qrclipAllocStats.heap_allocs++;
+            if (copy) {
+                const size_t old_size = ARENA_BLOCK_SIZE(ptr);
+
+                memcpy(copy, ptr, (old_size < size) ? old_size : size);
+            }
+            return copy;
+        }
+    } else {
+        qrclipAllocStats.heap_allocs++;
+        return realloc(ptr, size);
+    }
+}
+
+void
+QRclip_free(
+    void* ptr)
+{
+    QRclipArena* a = qrclipArena;
+
+    if (!ptr) {
+        return;
+    } else if (a && qrclip_arena_owns(a, ptr)) {
+        /* Never hand the arena memory over to free() */
+        if (a->depth) {
+            qrclip_arena_release(a, ptr);
+        }
+    } else {
+        free(ptr);
+    }
+}
+
+char*
+QRclip_strdup(
+    const char* str)
+{
+    const size_t size = strlen(str) + 1;
+    char* copy = QRclip_malloc(size);
+
+    if (copy) {
+        memcpy(copy, str, size);
+    }
+    return copy;
+}
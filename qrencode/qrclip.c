@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "qrclip.h"
+
+#include <stddef.h>
+
+/* Per-thread cancellation callback, see QRclip_setCancelFunc() */
+static __thread QRclipCancelFunc qrclipCancelFunc = NULL;
+static __thread void* qrclipCancelData = NULL;
+
+void
+QRclip_setCancelFunc(
+    QRclipCancelFunc func,
+    void* user_data)
+{
+    qrclipCancelFunc = func;
+    qrclipCancelData = func ? user_data : NULL;
+}
+
+int
+QRclip_isCanceled(void)
+{
+    return qrclipCancelFunc && qrclipCancelFunc(qrclipCancelData);
+}
+
+/* Per-thread parallel execution callback, see QRclip_setParallelFunc() */
+static __thread QRclipParallelFunc qrclipParallelFunc = NULL;
+static __thread void* qrclipParallelData = NULL;
+static __thread int qrclipParallelMinVersion = 0;
+
+void
+QRclip_setParallelFunc(
+    QRclipParallelFunc func,
+    void* user_data,
+    int min_version)
+{
+    qrclipParallelFunc = func;
+    qrclipParallelData = func ? user_data : NULL;
+    qrclipParallelMinVersion = func ? min_version : 0;
+}
+
+int
+QRclip_runParallel(
+    int version,
+    QRclipJobFunc job,
+    void* data,
+    int count)
+{
+    if (qrclipParallelFunc && version >= qrclipParallelMinVersion) {
+        qrclipParallelFunc(job, data, count, qrclipParallelData);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#ifndef QRCLIP_QRENCODE_H
+#define QRCLIP_QRENCODE_H
+
+/* Extensions to the bundled libqrencode, see qrencode.pro */
+
+#include "qrencode.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Cooperative cancellation. The callback is installed per thread and
+ * polled by the encoder at natural checkpoints (before each block of
+ * error correction and between mask trials). Once it returns non-zero,
+ * QRcode_encode* functions fail with ECANCELED, as far as regular QR
+ * codes are concerned. Micro QR encoding has no mask checkpoints, and
+ * libqrencode ignores the Reed-Solomon failure there, so it may return
+ * a corrupted symbol instead. The caller must check the callback once
+ * more after the encoder returns, and drop the result if it has been
+ * canceled. Pass NULL to remove the callback.
+ */
+typedef int (*QRclipCancelFunc)(void* user_data);
+
+void
+QRclip_setCancelFunc(
+    QRclipCancelFunc func,
+    void* user_data);
+
+int
+QRclip_isCanceled(void);
+
+/*
+ * Parallel mask trials. The callback is installed per thread, just like
+ * the cancellation one. Mask trials for the symbols of min_version and
+ * above are handed over to it as count independent jobs, which it may
+ * run concurrently. It must return when all of them are done. The mask
+ * is chosen the same way as by the serial code. Pass NULL to remove it.
+ */
+typedef void (*QRclipJobFunc)(void* data, int index);
+typedef void (*QRclipParallelFunc)(QRclipJobFunc job, void* data, int count,
+    void* user_data);
+
+void
+QRclip_setParallelFunc(
+    QRclipParallelFunc func,
+    void* user_data,
+    int min_version);
+
+/* Returns zero if there's no callback for this version */
+int
+QRclip_runParallel(
+    int version,
+    QRclipJobFunc job,
+    void* data,
+    int count);
+
+/*
+ * Per-thread allocation arena. Between QRclip_arenaBegin() and the
+ * matching QRclip_arenaEnd() the memory allocated by the encoder comes
+ * from a buffer owned by the calling thread and free() is (almost) a
+ * no-op. Everything is released in bulk by QRclip_arenaEnd(), so none
+ * of it may outlive the scope. The buffer is kept for the next scope
+ * and grown to fit the largest one so far, which means that once it
+ * has warmed up the encoder doesn't touch the heap at all. It's freed
+ * when the thread exits. Scopes can be nested, the outermost one wins.
+ * Outside of the scope the allocations go straight to the heap.
+ */
+void
+QRclip_arenaBegin(void);
+
+void
+QRclip_arenaEnd(void);
+
+/* Per-thread allocation counters, reset by QRclip_resetAllocStats() */
+typedef struct qrclip_alloc_stats {
+    unsigned long allocs;       /* malloc, calloc, realloc and strdup */
+    unsigned long heap_allocs;  /* Actual heap allocations, incl. arena */
+    size_t peak_bytes;          /* Peak arena usage in a single scope */
+} QRclipAllocStats;
+
+void
+QRclip_getAllocStats(
+    QRclipAllocStats* stats);
+
+void
+QRclip_resetAllocStats(void);
+
+/*
+ * Evaluates all mask patterns for the (unmasked) frame both ways and
+ * returns the number of patterns for which the bit-parallel penalty
+ * doesn't match the one calculated by the original libqrencode code.
+ * Anything other than zero is a bug.
+ */
+int
+QRclip_verifyMask(
+    int width,
+    unsigned char* frame,
+    QRecLevel level);
+
+/*
+ * The original libqrencode Reed-Solomon encoder, kept around for
+ * comparison with the table-driven RSECC_encode() which replaces it.
+ */
+int
+RSECC_encodeScalar(
+    size_t data_length,
+    size_t ecc_length,
+    const unsigned char* data,
+    unsigned char* ecc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QRCLIP_QRENCODE_H */
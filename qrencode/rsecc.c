@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+/*
+ * Table-driven replacement for RSECC_encode() from libqrencode/rsecc.c
+ *
+ * The original code does one log/antilog lookup (and a modulo) per ECC
+ * byte for every data byte. The encoder is a linear shift register, so
+ * each data byte can instead shift the ECC buffer by one byte and XOR
+ * it with a precomputed row of generator polynomial products selected
+ * by the feedback byte. The rows are derived from the original encoder
+ * itself (by encoding a single byte) which guarantees identical output.
+ * One table (256 rows of up to 32 bytes) is built per ECC length, when
+ * it's first needed. The XOR is done 16 or 8 bytes at a time.
+ *
+ * Each call is also a cancellation checkpoint, see QRclip_isCanceled()
+ *
+ * The upstream file is compiled as a part of this one, with its
+ * RSECC_encode() renamed.
+ */
+
+#define RSECC_encode RSECC_encodeScalar
+#include "../libqrencode/rsecc.c"
+#undef RSECC_encode
+
+#include "qrclip.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#  include <arm_neon.h>
+#endif
+
+/* The tables live as long as the process, not in the encoder's arena */
+#undef calloc
+
+#define RS_MAX_ECC (30)   /* Longest ECC block in QR and Micro QR */
+#define RS_ROW_SIZE (32)  /* Padded to the SIMD width */
+#define RS_ROWS (256)
+
+typedef struct rs_row {
+    unsigned char b[RS_ROW_SIZE];
+} RsRow;
+
+static RsRow* rsTables[RS_MAX_ECC + 1];
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t rsTablesMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/*
+ * Once a table is there, it's never modified or freed, so it can be
+ * read without locking. The table is fully built before the pointer is
+ * published (release), and whoever sees the pointer (acquire) sees the
+ * contents too. The mutex only serializes building the missing ones.
+ */
+#ifdef __GNUC__
+#  define RS_TABLE_LOAD(i) __atomic_load_n(rsTables + (i), __ATOMIC_ACQUIRE)
+#  define RS_TABLE_STORE(i,t) __atomic_store_n(rsTables + (i), t, __ATOMIC_RELEASE)
+#else
+#  define RS_TABLE_LOAD(i) (NULL)  /* Always goes through the mutex */
+#  define RS_TABLE_STORE(i,t) (rsTables[i] = (t))
+#endif
+
+static
+const RsRow*
+rs_table_build(
+    size_t ecc_length)
+{
+    RsRow* table;
+
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&rsTablesMutex);
+#endif
+    /* Someone may have built it while we were waiting */
+    table = rsTables[ecc_length];
+    if (!table) {
+        table = calloc(RS_ROWS, sizeof(RsRow));
+        if (table) {
+            int i;
+
+            /* Encoding a single byte yields the row for that feedback */
+            for (i = 0; i < RS_ROWS; i++) {
+                const unsigned char fb = (unsigned char)i;
+
+                RSECC_encodeScalar(1, ecc_length, &fb, table[i].b);
+            }
+            RS_TABLE_STORE(ecc_length, table);
+        }
+    }
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&rsTablesMutex);
+#endif
+    return table;
+}
+
+static
+inline
+const RsRow*
+rs_table(
+    size_t ecc_length)
+{
+    const RsRow* table = RS_TABLE_LOAD(ecc_length);
+
+    return table ? table : rs_table_build(ecc_length);
+}
+
+static
+inline
+void
+rs_xor_row(
+    unsigned char* ecc,
+    const unsigned char* row)
+{
+#if defined(__SSE2__)
+    __m128i* e = (__m128i*)ecc;
+    const __m128i* r = (const __m128i*)row;
+
+    _mm_storeu_si128(e, _mm_xor_si128(_mm_loadu_si128(e),
+        _mm_loadu_si128(r)));
+    _mm_storeu_si128(e + 1, _mm_xor_si128(_mm_loadu_si128(e + 1),
+        _mm_loadu_si128(r + 1)));
+#elif defined(__ARM_NEON)
+    vst1q_u8(ecc, veorq_u8(vld1q_u8(ecc), vld1q_u8(row)));
+    vst1q_u8(ecc + 16, veorq_u8(vld1q_u8(ecc + 16), vld1q_u8(row + 16)));
+#else
+    int i;
+
+    for (i = 0; i < RS_ROW_SIZE; i += sizeof(uint64_t)) {
+        uint64_t a, b;
+
+        memcpy(&a, ecc + i, sizeof(a));
+        memcpy(&b, row + i, sizeof(b));
+        a ^= b;
+        memcpy(ecc + i, &a, sizeof(a));
+    }
+#endif
+}
+
+int
+RSECC_encode(
+    size_t data_length,
+    size_t ecc_length,
+    const unsigned char* data,
+    unsigned char* ecc)
+{
+    const RsRow* table;
+    unsigned char buf[RS_ROW_SIZE + 1];
+    size_t i;
+
+    if (QRclip_isCanceled()) {
+        /* The result is going to be thrown away anyway */
+        memset(ecc, 0, ecc_length);
+        return -1;
+    }
+
+    if (ecc_length < 2 || ecc_length > RS_MAX_ECC ||
+        !(table = rs_table(ecc_length))) {
+        /* Let the original code deal with it */
+        return RSECC_encodeScalar(data_length, ecc_length, data, ecc);
+    }
+
+    /* Rows are zero-padded, so are the extra bytes of the buffer */
+    memset(buf, 0, sizeof(buf));
+    for (i = 0; i < data_length; i++) {
+        const unsigned char fb = data[i] ^ buf[0];
+
+        memmove(buf, buf + 1, RS_ROW_SIZE);
+        if (fb) {
+            rs_xor_row(buf, table[fb].b);
+        }
+    }
+    memcpy(ecc, buf, ecc_length);
+    return 0;
+}
@@ -0,0 +1,477 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "BatchEncoder.h"
+#include "FileUtils.h"
+#include "QrCodeGenerator.h"
+#include "QrCodeImageProvider.h"
+
+#include "HarbourDebug.h"
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QThreadPool>
+#include <QtCore/QtEndian>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <stdio.h>
+#include <string.h>
+
+// Number of records read and encoded in one go (per thread)
+#define BATCH_RECORDS_PER_THREAD (64)
+
+// Packed binary container (all numbers are big-endian):
+//
+// Header:
+//   4 bytes  "QRCB"
+//   1 byte   format version (1)
+//   3 bytes  reserved (zeros)
+//
+// Record (one per generated code, in the input order):
+//   4 bytes  record number (zero-based)
+//   1 byte   EC level (0..3 = L, M, Q, H)
+//   1 byte   reserved (zero)
+//   2 bytes  number of modules per side (N)
+//   4 bytes  number of bytes that follow ((N + 7)/8 * N)
+//   ...      rows of packed bits, MSB first, each padded to a byte
+#define BATCH_BIN_MAGIC "QRCB"
+#define BATCH_BIN_VERSION (1)
+#define BATCH_BIN_FILE "codes.bin"
+
+const char BatchEncoder::OPTION[] = "--batch";
+
+// ==========================================================================
+// BatchEncoder::Config
+// ==========================================================================
+
+class BatchEncoder::Config
+{
+public:
+    enum Format {
+        FormatPng,
+        FormatSvg,
+        FormatBin
+    };
+
+    Config();
+
+    bool parse(const QStringList&);
+    QString fileName(int, int) const;
+
+public:
+    QString iInput;
+    QDir iOutDir;
+    Format iFormat;
+    char iDelimiter;
+    uint iLevels;
+    QrCodeGenerator::Segmentation iSegmentation;
+    int iScale;
+    int iThreads;
+};
+
+BatchEncoder::Config::Config() :
+    iFormat(FormatPng),
+    iDelimiter('\n'),
+    iLevels(1u << HarbourQrCodeGenerator::ECLevelDefault),
+    iSegmentation(QrCodeGenerator::SegmentationGreedy),
+    iScale(5),
+    iThreads(QThread::idealThreadCount())
+{
+}
+
+bool
+BatchEncoder::Config::parse(
+    const QStringList& aArgs)
+{
+    QCommandLineParser parser;
+    QCommandLineOption batch(QString(OPTION).mid(2),
+        "Batch mode (required).");
+    QCommandLineOption input(QStringList() << "i" << "input",
+        "Read records from <file> (default is stdin).", "file", "-");
+    QCommandLineOption nul(QStringList() << "0" << "null",
+        "Records are NUL-delimited (default is one per line).");
+    QCommandLineOption level(QStringList() << "l" << "level",
+        "EC level(s) to generate, any of LMQH (default is M).", "levels", "M");
+    QCommandLineOption optimal(QStringList() << "O" << "optimal",
+        "Use optimal segmentation (smaller codes for mixed content).");
+    QCommandLineOption format(QStringList() << "f" << "format",
+        "Output format: png, svg or bin (default is png).", "format", "png");
+    QCommandLineOption scale(QStringList() << "s" << "scale",
+        "Pixels per module (default is 5).", "n", "5");
+    QCommandLineOption jobs(QStringList() << "j" << "jobs",
+        "Number of worker threads (default is the number of cores).", "n",
+        QString::number(iThreads));
+    QCommandLineOption output(QStringList() << "o" << "output",
+        "Output directory (default is the current directory).", "dir", ".");
+
+    parser.setApplicationDescription("Generates QR codes in bulk.");
+    parser.addHelpOption();
+    parser.addOption(batch);
+    parser.addOption(input);
+    parser.addOption(nul);
+    parser.addOption(level);
+    parser.addOption(optimal);
+    parser.addOption(format);
+    parser.addOption(scale);
+    parser.addOption(jobs);
+    parser.addOption(output);
+    parser.process(aArgs);
+
+    bool ok = true;
+    iInput = parser.value(input);
+    iDelimiter = parser.isSet(nul) ? '\0' : '\n';
+    iSegmentation = parser.isSet(optimal) ?
+        QrCodeGenerator::SegmentationOptimal :
+        QrCodeGenerator::SegmentationGreedy;
+
+    iLevels = 0;
+    const QString levels(parser.value(level).toUpper());
+    for (int i = 0; i < levels.length(); i++) {
+        const int l = QString("LMQH").indexOf(levels.at(i));
+        if (l >= 0) {
+            iLevels |= (1u << l);
+        } else if (levels.at(i) != ',') {
+            ok = false;
+        }
+    }
+    if (!ok || !iLevels) {
+        fprintf(stderr, "Invalid EC level(s) '%s'\n", qPrintable(levels));
+        return false;
+    }
+
+    const QString fmt(parser.value(format).toLower());
+    if (fmt == QLatin1String("png")) {
+        iFormat = FormatPng;
+    } else if (fmt == QLatin1String("svg")) {
+        iFormat = FormatSvg;
+    } else if (fmt == QLatin1String("bin")) {
+        iFormat = FormatBin;
+    } else {
+        fprintf(stderr, "Invalid format '%s'\n", qPrintable(fmt));
+        return false;
+    }
+
+    iScale = parser.value(scale).toInt(&ok);
+    if (!ok || iScale < 1) {
+        fprintf(stderr, "Invalid scale '%s'\n", qPrintable(parser.value(scale)));
+        return false;
+    }
+
+    iThreads = parser.value(jobs).toInt(&ok);
+    if (!ok || iThreads < 1) {
+        fprintf(stderr, "Invalid number of jobs '%s'\n", qPrintable(parser.value(jobs)));
+        return false;
+    }
+
+    const QString dir(parser.value(output));
+    if (!QDir(dir).exists() && !QDir().mkpath(dir)) {
+        fprintf(stderr, "Can't create directory %s\n", qPrintable(dir));
+        return false;
+    }
+    iOutDir = QDir(dir);
+    return true;
+}
+
+QString
+BatchEncoder::Config::fileName(
+    int aRecord,
+    int aLevel) const
+{
+    // Names only depend on the input, not on the order of completion
+    return iOutDir.filePath(QString().sprintf("%06d-%c.%s", aRecord,
+        "LMQH"[aLevel], (iFormat == FormatSvg) ? "svg" : "png"));
+}
+
+// ==========================================================================
+// BatchEncoder::Job
+// ==========================================================================
+
+class BatchEncoder::Job
+{
+public:
+    Job() : iConfig(Q_NULLPTR), iRecord(0), iLevel(0) {}
+    Job(const Config* aConfig, int aRecord, int aLevel, const QString& aText) :
+        iConfig(aConfig), iRecord(aRecord), iLevel(aLevel), iText(aText) {}
+
+public:
+    const Config* iConfig;
+    int iRecord;
+    int iLevel;
+    QString iText;
+};
+
+// ==========================================================================
+// BatchEncoder::Result
+// ==========================================================================
+
+class BatchEncoder::Result
+{
+public:
+    Result() : iRecord(0), iLevel(0), iBytesWritten(0), iOk(false) {}
+
+public:
+    int iRecord;
+    int iLevel;
+    QByteArray iBits;
+    qint64 iBytesWritten;
+    bool iOk;
+};
+
+// ==========================================================================
+// BatchEncoder::Reader
+// ==========================================================================
+
+class BatchEncoder::Reader
+{
+public:
+    Reader(QIODevice*, char);
+
+    bool next(QByteArray*);
+
+public:
+    qint64 iBytesRead;
+
+private:
+    QIODevice* iDevice;
+    const char iDelimiter;
+    QByteArray iBuf;
+    int iPos;
+    bool iEof;
+};
+
+BatchEncoder::Reader::Reader(
+    QIODevice* aDevice,
+    char aDelimiter) :
+    iBytesRead(0),
+    iDevice(aDevice),
+    iDelimiter(aDelimiter),
+    iPos(0),
+    iEof(false)
+{
+}
+
+bool
+BatchEncoder::Reader::next(
+    QByteArray* aRecord)
+{
+    for (;;) {
+        const int end = iBuf.indexOf(iDelimiter, iPos);
+        if (end >= 0) {
+            *aRecord = iBuf.mid(iPos, end - iPos);
+            iPos = end + 1;
+            break;
+        } else if (iEof) {
+            if (iPos < iBuf.size()) {
+                // The last record is not terminated
+                *aRecord = iBuf.mid(iPos);
+                iPos = iBuf.size();
+                break;
+            }
+            return false;
+        } else {
+            const QByteArray chunk(iDevice->read(0x10000));
+            iBuf = iBuf.mid(iPos) + chunk;
+            iPos = 0;
+            iBytesRead += chunk.size();
+            iEof = chunk.isEmpty();
+        }
+    }
+    if (iDelimiter == '\n' && aRecord->endsWith('\r')) {
+        aRecord->chop(1);
+    }
+    return true;
+}
+
+// ==========================================================================
+// BatchEncoder
+// ==========================================================================
+
+bool
+BatchEncoder::isBatchMode(
+    int aArgc,
+    char** aArgv)
+{
+    for (int i = 1; i < aArgc; i++) {
+        if (!strcmp(aArgv[i], OPTION)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+BatchEncoder::Result
+BatchEncoder::encode(
+    const Job& aJob)
+{
+    // Runs on a worker thread
+    const Config* config = aJob.iConfig;
+    Result result;
+
+    result.iRecord = aJob.iRecord;
+    result.iLevel = aJob.iLevel;
+    result.iBits = QrCodeGenerator::generate(aJob.iText,
+        (HarbourQrCodeGenerator::ECLevel)aJob.iLevel, config->iSegmentation);
+    if (!result.iBits.isEmpty()) {
+        if (config->iFormat == Config::FormatBin) {
+            // Written by the main thread, in order
+            result.iOk = true;
+        } else {
+            QFile file(config->fileName(aJob.iRecord, aJob.iLevel));
+            if (file.open(QIODevice::WriteOnly)) {
+                result.iOk = (config->iFormat == Config::FormatSvg) ?
+                    FileUtils::writeSvg(&file, result.iBits, config->iScale) :
+                    FileUtils::writePng(&file, result.iBits, config->iScale);
+                result.iBytesWritten = file.pos();
+                file.close();
+                if (!result.iOk) {
+                    file.remove();
+                }
+            }
+            // Don't need to keep those around
+            result.iBits.clear();
+        }
+    }
+    return result;
+}
+
+int
+BatchEncoder::run(
+    const QStringList& aArgs)
+{
+    Config config;
+    if (!config.parse(aArgs)) {
+        return 1;
+    }
+
+    QFile in;
+    if (config.iInput == QLatin1String("-")) {
+        in.open(stdin, QIODevice::ReadOnly);
+    } else {
+        in.setFileName(config.iInput);
+        in.open(QIODevice::ReadOnly);
+    }
+    if (!in.isOpen()) {
+        fprintf(stderr, "Can't open %s\n", qPrintable(config.iInput));
+        return 1;
+    }
+
+    QFile bin;
+    if (config.iFormat == Config::FormatBin) {
+        static const char header[8] = { 'Q', 'R', 'C', 'B', BATCH_BIN_VERSION, 0, 0, 0 };
+        bin.setFileName(config.iOutDir.filePath(BATCH_BIN_FILE));
+        if (!bin.open(QIODevice::WriteOnly) ||
+            bin.write(header, sizeof(header)) != sizeof(header)) {
+            fprintf(stderr, "Can't write %s\n", qPrintable(bin.fileName()));
+            return 1;
+        }
+    }
+
+    QThreadPool::globalInstance()->setMaxThreadCount(config.iThreads);
+
+    QElapsedTimer timer;
+    Reader reader(&in, config.iDelimiter);
+    const int batchSize = config.iThreads * BATCH_RECORDS_PER_THREAD;
+    qint64 bytesWritten = 0;
+    int records = 0, codes = 0, failed = 0;
+    bool eof = false, ok = true;
+
+    timer.start();
+    while (!eof && ok) {
+        QList<Job> jobs;
+        QByteArray record;
+
+        // Read the next batch
+        for (int n = 0; n < batchSize; n++) {
+            if (reader.next(&record)) {
+                const QString text(QString::fromUtf8(record));
+                for (int l = 0; l < HarbourQrCodeGenerator::ECLevelCount; l++) {
+                    if (config.iLevels & (1u << l)) {
+                        jobs.append(Job(&config, records, l, text));
+                    }
+                }
+                records++;
+            } else {
+                eof = true;
+                break;
+            }
+        }
+
+        // The results come back in the same order as the jobs
+        const QList<Result> results(QtConcurrent::blockingMapped(jobs, encode));
+        for (int i = 0; i < results.count() && ok; i++) {
+            const Result& r = results.at(i);
+            if (r.iOk) {
+                codes++;
+                if (config.iFormat == Config::FormatBin) {
+                    const int size = QrCodeImageProvider::moduleCount(r.iBits);
+                    uchar head[12];
+                    qToBigEndian<quint32>(r.iRecord, head);
+                    head[4] = (uchar)r.iLevel;
+                    head[5] = 0;
+                    qToBigEndian<quint16>(size, head + 6);
+                    qToBigEndian<quint32>(r.iBits.size(), head + 8);
+                    ok = bin.write((char*)head, sizeof(head)) == sizeof(head) &&
+                        bin.write(r.iBits) == r.iBits.size();
+                    bytesWritten += sizeof(head) + r.iBits.size();
+                } else {
+                    bytesWritten += r.iBytesWritten;
+                }
+            } else {
+                failed++;
+                fprintf(stderr, "Record %d level %c failed\n", r.iRecord,
+                    "LMQH"[r.iLevel]);
+            }
+        }
+    }
+
+    if (bin.isOpen()) {
+        bin.close();
+    }
+    if (!ok) {
+        fprintf(stderr, "Write error\n");
+    }
+
+    const double sec = qMax(timer.nsecsElapsed(), Q_INT64_C(1)) / 1e9;
+    fprintf(stderr, "%d record(s), %d code(s), %d failed in %.3f s\n"
+        "%.1f codes/s, %.2f MB/s in, %.2f MB/s out\n", records, codes,
+        failed, sec, codes / sec, reader.iBytesRead / sec / 1e6,
+        bytesWritten / sec / 1e6);
+    return (ok && !failed) ? 0 : 2;
+}
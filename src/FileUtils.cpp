@@ -38,20 +38,432 @@
  */
 
 #include "FileUtils.h"
+#include "QrCodeImageProvider.h"
+#include "QrCodeRegistry.h"
 
-#include "HarbourQrCodeImageProvider.h"
-#include "HarbourBase32.h"
 #include "HarbourDebug.h"
+#include "HarbourTask.h"
+
+#include <QtConcurrent/QtConcurrentRun>
 
 #include <QtCore/QDir>
 #include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
 #include <QtCore/QStandardPaths>
-#include <QtGui/QPainter>
+#include <QtCore/QThreadPool>
+#include <QtCore/QtEndian>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+// ==========================================================================
+// FileUtils::PngWriter
+//
+// Streams the image row by row through zlib. Only one scanline and one
+// IDAT chunk worth of compressed data are kept in memory at any time.
+// ==========================================================================
+
+class FileUtils::PngWriter
+{
+public:
+    enum {
+        ChunkSize = 0x2000, // IDAT payload
+        Border = 1          // Quiet zone (modules)
+    };
+
+    PngWriter(QIODevice*);
+    ~PngWriter();
+
+    bool write(const QByteArray&, int, int);
+
+private:
+    bool writeChunk(const char*, const void*, uint);
+    bool writeHeader(uint, uint);
+    bool compress(const void*, uint, int);
+
+private:
+    QIODevice* iOut;
+    z_stream iStream;
+    bool iStreamOk;
+    uint iChunkUsed;
+    uchar iChunk[ChunkSize];
+};
+
+FileUtils::PngWriter::PngWriter(
+    QIODevice* aOut) :
+    iOut(aOut),
+    iChunkUsed(0)
+{
+    memset(&iStream, 0, sizeof(iStream));
+    iStreamOk = (deflateInit(&iStream, Z_DEFAULT_COMPRESSION) == Z_OK);
+}
+
+FileUtils::PngWriter::~PngWriter()
+{
+    if (iStreamOk) {
+        deflateEnd(&iStream);
+    }
+}
+
+bool
+FileUtils::PngWriter::writeChunk(
+    const char* aType,
+    const void* aData,
+    uint aSize)
+{
+    uchar head[8], tail[4];
+    qToBigEndian<quint32>(aSize, head);
+    memcpy(head + 4, aType, 4);
+
+    // CRC covers the chunk type and the data
+    uLong crc = crc32(0, head + 4, 4);
+    if (aSize) {
+        crc = crc32(crc, (const Bytef*)aData, aSize);
+    }
+    qToBigEndian<quint32>(crc, tail);
+
+    return iOut->write((char*)head, sizeof(head)) == sizeof(head) &&
+        (!aSize || iOut->write((const char*)aData, aSize) == aSize) &&
+        iOut->write((char*)tail, sizeof(tail)) == sizeof(tail);
+}
+
+bool
+FileUtils::PngWriter::writeHeader(
+    uint aWidth,
+    uint aHeight)
+{
+    static const uchar signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    uchar ihdr[13];
+
+    qToBigEndian<quint32>(aWidth, ihdr);
+    qToBigEndian<quint32>(aHeight, ihdr + 4);
+    ihdr[8] = 1;   // Bit depth
+    ihdr[9] = 0;   // Grayscale
+    ihdr[10] = 0;  // Deflate
+    ihdr[11] = 0;  // Adaptive filtering
+    ihdr[12] = 0;  // No interlace
+
+    return iOut->write((char*)signature, sizeof(signature)) == sizeof(signature) &&
+        writeChunk("IHDR", ihdr, sizeof(ihdr));
+}
+
+bool
+FileUtils::PngWriter::compress(
+    const void* aData,
+    uint aSize,
+    int aFlush)
+{
+    int ret;
+
+    iStream.next_in = (Bytef*)aData;
+    iStream.avail_in = aSize;
+    do {
+        iStream.next_out = iChunk + iChunkUsed;
+        iStream.avail_out = ChunkSize - iChunkUsed;
+        ret = deflate(&iStream, aFlush);
+        if (ret == Z_STREAM_ERROR) {
+            HWARN("deflate error");
+            return false;
+        }
+        iChunkUsed = ChunkSize - iStream.avail_out;
+        if (iChunkUsed == ChunkSize || (ret == Z_STREAM_END && iChunkUsed)) {
+            if (!writeChunk("IDAT", iChunk, iChunkUsed)) {
+                return false;
+            }
+            iChunkUsed = 0;
+        }
+    } while (iStream.avail_in || (aFlush == Z_FINISH && ret != Z_STREAM_END));
+    return true;
+}
+
+bool
+FileUtils::PngWriter::write(
+    const QByteArray& aBits,
+    int aSize,
+    int aScale)
+{
+    // Each module becomes aScale x aScale pixels, same as QImage::scaled()
+    // with Qt::FastTransformation and the integer scale factor would do.
+    const int bytesPerRow = (aSize + 7) / 8;
+    const int w = (aSize + 2 * Border) * aScale;
+    const int lineSize = 1 + (w + 7) / 8;
+    const uchar* bits = (const uchar*)aBits.constData();
+    QByteArray line(lineSize, 0);
+    uchar* pixels = (uchar*)line.data() + 1;
+
+    if (!iStreamOk || !writeHeader(w, w)) {
+        return false;
+    }
+
+    // line[0] is the filter type (none)
+    for (int y = -Border; y < aSize + Border; y++) {
+        // Zero bits are black, set them for white pixels
+        const uchar* row = (y >= 0 && y < aSize) ? (bits + y * bytesPerRow) : Q_NULLPTR;
+        memset(pixels, 0, lineSize - 1);
+        for (int x = 0; x < w; x++) {
+            const int m = x / aScale - Border;
+            if (!row || m < 0 || m >= aSize || !(row[m / 8] & (0x80 >> (m % 8)))) {
+                pixels[x / 8] |= (0x80 >> (x % 8));
+            }
+        }
+        for (int i = 0; i < aScale; i++) {
+            if (!compress(line.constData(), lineSize, Z_NO_FLUSH)) {
+                return false;
+            }
+        }
+    }
+
+    return compress(Q_NULLPTR, 0, Z_FINISH) && writeChunk("IEND", Q_NULLPTR, 0);
+}
+
+// ==========================================================================
+// FileUtils::FileNames
+//
+// Files are named <prefix>.png, <prefix>-001.png, <prefix>-002.png and
+// so on. The directory is scanned once per prefix, after that the next
+// index is known. Names are claimed by creating the file exclusively,
+// so that even other processes can't grab the same name.
+// ==========================================================================
+
+class FileUtils::FileNames
+{
+public:
+    QString claim(const QString&, const QString&);
+
+private:
+    static QString fileName(const QString&, int);
+    static int scan(const QString&, const QString&);
+
+private:
+    QMutex iMutex;
+    QHash<QString,int> iNextIndex;
+};
+
+Q_GLOBAL_STATIC(FileUtils::FileNames, fileNames)
+
+QString
+FileUtils::FileNames::fileName(
+    const QString& aPrefix,
+    int aIndex)
+{
+    static const QString suffix(".png");
+    return aIndex ? (aPrefix + QString().sprintf("-%03d", aIndex) + suffix) :
+        (aPrefix + suffix);
+}
+
+int
+FileUtils::FileNames::scan(
+    const QString& aDir,
+    const QString& aBaseName)
+{
+    // The index following the largest one in use
+    const QString suffix(".png");
+    const QStringList files(QDir(aDir).entryList(QStringList(aBaseName +
+        "*" + suffix), QDir::Files | QDir::Hidden));
+    const int prefixLen = aBaseName.length();
+    int next = 0;
+
+    for (int i = 0; i < files.count(); i++) {
+        const QString& file = files.at(i);
+        const int len = file.length() - prefixLen - suffix.length();
+        if (!len) {
+            next = qMax(next, 1);
+        } else if (len > 1 && file.at(prefixLen) == QChar('-')) {
+            bool ok;
+            const int index = file.mid(prefixLen + 1, len - 1).toInt(&ok);
+            if (ok && index > 0) {
+                next = qMax(next, index + 1);
+            }
+        }
+    }
+    HDEBUG(files.count() << "files in" << qPrintable(aDir) << "next" << next);
+    return next;
+}
+
+QString
+FileUtils::FileNames::claim(
+    const QString& aDir,
+    const QString& aBaseName)
+{
+    const QString prefix(aDir + QDir::separator() + aBaseName);
+    QMutexLocker lock(&iMutex);
+    QHash<QString,int>::iterator it = iNextIndex.find(prefix);
+
+    if (it == iNextIndex.end()) {
+        it = iNextIndex.insert(prefix, scan(aDir, aBaseName));
+    }
+
+    // Normally the first attempt succeeds. If it doesn't, someone else
+    // must have created the file behind our back.
+    for (int index = it.value(); index >= 0; index++) {
+        const QString path(fileName(prefix, index));
+        const QByteArray fname(QFile::encodeName(path));
+        const int fd = open(fname.constData(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+
+        if (fd >= 0) {
+            close(fd);
+            it.value() = index + 1;
+            return path;
+        } else if (errno != EEXIST) {
+            HWARN("Cannot create" << qPrintable(path) << strerror(errno));
+            break;
+        }
+    }
+    return QString();
+}
+
+// ==========================================================================
+// FileUtils::SaveTask
+//
+// File names are claimed one after another, then the files are written
+// in parallel (the first one on this thread, the rest on the global
+// pool). Each file is rendered and compressed at the same time, one
+// scanline at a time, so this overlaps the rendering of one image with
+// the compression of another.
+// ==========================================================================
+
+class FileUtils::SaveTask :
+    public HarbourTask
+{
+    Q_OBJECT
+
+public:
+    SaveTask(QThreadPool*, int, const QList<QByteArray>&, const QString&,
+        const QString&, int);
+    void performTask() Q_DECL_OVERRIDE;
+
+private:
+    static bool save(const QString&, const QByteArray&, int);
+
+public:
+    const int iId;
+    const QList<QByteArray> iBits;
+    const QString iSubDir;
+    const QString iBaseName;
+    const int iScale;
+    QStringList iPaths;
+    QString iError;
+};
+
+FileUtils::SaveTask::SaveTask(
+    QThreadPool* aPool,
+    int aId,
+    const QList<QByteArray>& aBits,
+    const QString& aSubDir,
+    const QString& aBaseName,
+    int aScale) :
+    HarbourTask(aPool),
+    iId(aId),
+    iBits(aBits),
+    iSubDir(aSubDir),
+    iBaseName(aBaseName),
+    iScale(aScale)
+{
+}
+
+bool
+FileUtils::SaveTask::save(
+    const QString& aPath,
+    const QByteArray& aBits,
+    int aScale)
+{
+    return !aPath.isEmpty() && savePng(aPath, aBits, aScale);
+}
+
+void
+FileUtils::SaveTask::performTask()
+{
+    const int n = iBits.count();
+    const QString dir(galleryDir(iSubDir));
+    QList<QFuture<bool> > jobs;
+
+    if (dir.isEmpty()) {
+        iError = QStringLiteral("Cannot create directory");
+        for (int i = 0; i < n; i++) {
+            iPaths.append(QString());
+        }
+        return;
+    }
+
+    for (int i = 0; i < n; i++) {
+        iPaths.append(QrCodeImageProvider::moduleCount(iBits.at(i)) > 0 ?
+            newFileName(dir, iBaseName) : QString());
+    }
+    for (int i = 1; i < n; i++) {
+        jobs.append(QtConcurrent::run(QThreadPool::globalInstance(), save,
+            iPaths.at(i), iBits.at(i), iScale));
+    }
+
+    int failed = (n > 0 && !save(iPaths.at(0), iBits.at(0), iScale)) ? 1 : 0;
+    if (failed) {
+        iPaths[0] = QString();
+    }
+    for (int i = 1; i < n; i++) {
+        // Runs the job on this thread if it hasn't started yet
+        QFuture<bool>& job = jobs[i - 1];
+        job.waitForFinished();
+        if (!job.result()) {
+            iPaths[i] = QString();
+            failed++;
+        }
+    }
+    if (failed) {
+        iError = QString("Failed to save %1 of %2").arg(failed).arg(n);
+        HWARN(qPrintable(iError));
+    }
+}
+
+// ==========================================================================
+// FileUtils::Private
+// ==========================================================================
+
+class FileUtils::Private
+{
+public:
+    Private(QObject*);
+    ~Private();
+
+public:
+    QThreadPool* iThreadPool;
+    QList<SaveTask*> iTasks;
+    int iLastId;
+};
+
+FileUtils::Private::Private(
+    QObject* aParent) :
+    iThreadPool(new QThreadPool(aParent)),
+    iLastId(0)
+{
+    // Save requests are executed in the order they were submitted
+    iThreadPool->setMaxThreadCount(1);
+}
+
+FileUtils::Private::~Private()
+{
+    for (int i = 0; i < iTasks.count(); i++) {
+        iTasks.at(i)->release();
+    }
+    iThreadPool->waitForDone();
+}
+
+// ==========================================================================
+// FileUtils
+// ==========================================================================
 
 FileUtils::FileUtils(
     QObject* aParent) :
-    QObject(aParent)
+    QObject(aParent),
+    iPrivate(new Private(this))
+{
+}
+
+FileUtils::~FileUtils()
 {
+    delete iPrivate;
 }
 
 // Callback for qmlRegisterSingletonType<FileUtils>
@@ -63,55 +475,191 @@ FileUtils::createSingleton(
     return new FileUtils();
 }
 
-QString
-FileUtils::saveToGallery(
-    QString aBase32,
-    QString aSubDir,
-    QString aBaseName,
+bool
+FileUtils::writePng(
+    QIODevice* aOut,
+    const QByteArray& aBits,
+    int aScale)
+{
+    const int n = QrCodeImageProvider::moduleCount(aBits);
+    if (n > 0) {
+        return PngWriter(aOut).write(aBits, n, qMax(aScale, 1));
+    }
+    return false;
+}
+
+bool
+FileUtils::writeSvg(
+    QIODevice* aOut,
+    const QByteArray& aBits,
     int aScale)
 {
-    const QByteArray bits(HarbourBase32::fromBase32(aBase32.toLocal8Bit()));
-    HDEBUG(aBase32 << "=>" << bits.size() << "bytes");
-    QImage qrcode(HarbourQrCodeImageProvider::createImage(bits));
-    if (!qrcode.isNull()) {
-        // Draw one-pixel white square around QR code
-        const int w = qrcode.width() + 2;
-        const int h = qrcode.height() + 2;
-        QImage img(w, h, QImage::Format_ARGB32);
-        QPainter painter(&img);
-        painter.fillRect(0, 0, w, h, Qt::white);
-        painter.drawImage(1, 1, qrcode);
-        painter.end();
-
-        if (aScale > 1) {
-            HDEBUG(w << "x" << h << "=>" <<  (w * aScale) << "x" << (h * aScale));
-            img = img.scaledToHeight(h * aScale);
+    const int n = QrCodeImageProvider::moduleCount(aBits);
+    if (n > 0) {
+        // Coordinates are in modules, the border is one module wide
+        const int size = n + 2 * PngWriter::Border;
+        const int pixels = size * qMax(aScale, 1);
+        const int bytesPerRow = (n + 7) / 8;
+        const uchar* bits = (const uchar*)aBits.constData();
+        QByteArray buf;
+
+        buf.append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" width=\"");
+        buf.append(QByteArray::number(pixels));
+        buf.append("\" height=\"");
+        buf.append(QByteArray::number(pixels));
+        buf.append("\" viewBox=\"0 0 ");
+        buf.append(QByteArray::number(size));
+        buf.append(' ');
+        buf.append(QByteArray::number(size));
+        buf.append("\" shape-rendering=\"crispEdges\">\n"
+            "<rect width=\"100%\" height=\"100%\" fill=\"#fff\"/>\n"
+            "<path fill=\"#000\" d=\"");
+        if (aOut->write(buf) != buf.size()) {
+            return false;
         }
 
-        // Write the file
-        QString destDir = QStandardPaths::writableLocation(QStandardPaths::PicturesLocation);
-        if (!destDir.isEmpty()) {
-            if (!aSubDir.isEmpty()) {
-                destDir += QDir::separator() + aSubDir;
-            }
-            if (aBaseName.isEmpty()) aBaseName = QLatin1String("image");
-            if (QFile::exists(destDir) || QDir(destDir).mkpath(destDir)) {
-                static const QString suffix(".png");
-                const QString prefix(destDir + QDir::separator() + aBaseName);
-                QString destFile = prefix + suffix;
-                for (int i = 1; QFile::exists(destFile); i++) {
-                    destFile = prefix + QString().sprintf("-%03d", i) + suffix;
-                }
-                if (img.save(destFile)) {
-                    HDEBUG(destFile);
-                    return destFile;
+        // One subpath per horizontal run of dark modules
+        for (int y = 0; y < n; y++, bits += bytesPerRow) {
+            buf.resize(0);
+            for (int x = 0; x < n;) {
+                if (bits[x / 8] & (0x80 >> (x % 8))) {
+                    const int x0 = x++;
+                    while (x < n && (bits[x / 8] & (0x80 >> (x % 8)))) x++;
+                    buf.append('M');
+                    buf.append(QByteArray::number(x0 + PngWriter::Border));
+                    buf.append(' ');
+                    buf.append(QByteArray::number(y + PngWriter::Border));
+                    buf.append('h');
+                    buf.append(QByteArray::number(x - x0));
+                    buf.append("v1h-");
+                    buf.append(QByteArray::number(x - x0));
+                    buf.append('z');
                 } else {
-                    HWARN("Cannot save" << qPrintable(destFile));
+                    x++;
                 }
-            } else {
-                HWARN("Cannot create directory" << qPrintable(destDir));
+            }
+            if (!buf.isEmpty() && aOut->write(buf) != buf.size()) {
+                return false;
+            }
+        }
+
+        static const char tail[] = "\"/>\n</svg>\n";
+        return aOut->write(tail, sizeof(tail) - 1) == (qint64)(sizeof(tail) - 1);
+    }
+    return false;
+}
+
+QString
+FileUtils::galleryDir(
+    const QString& aSubDir)
+{
+    // Creates the directory if necessary
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::PicturesLocation);
+    if (!dir.isEmpty()) {
+        if (!aSubDir.isEmpty()) {
+            dir += QDir::separator() + aSubDir;
+        }
+        if (QFile::exists(dir) || QDir(dir).mkpath(dir)) {
+            return dir;
+        }
+        HWARN("Cannot create directory" << qPrintable(dir));
+    }
+    return QString();
+}
+
+QString
+FileUtils::newFileName(
+    const QString& aDir,
+    const QString& aBaseName)
+{
+    return fileNames()->claim(aDir, aBaseName.isEmpty() ?
+        QString("image") : aBaseName);
+}
+
+bool
+FileUtils::savePng(
+    const QString& aPath,
+    const QByteArray& aBits,
+    int aScale)
+{
+    QFile file(aPath);
+    if (file.open(QIODevice::WriteOnly)) {
+        if (writePng(&file, aBits, aScale)) {
+            HDEBUG(aPath);
+            return true;
+        }
+        file.remove();
+    }
+    HWARN("Cannot save" << qPrintable(aPath));
+    return false;
+}
+
+QString
+FileUtils::saveToGallery(
+    QString aCode,
+    QString aSubDir,
+    QString aBaseName,
+    int aScale)
+{
+    const QByteArray bits(QrCodeRegistry::find(aCode));
+    HDEBUG(aCode << "=>" << bits.size() << "bytes");
+    if (QrCodeImageProvider::moduleCount(bits) > 0) {
+        const QString dir(galleryDir(aSubDir));
+        if (!dir.isEmpty()) {
+            const QString path(newFileName(dir, aBaseName));
+            if (!path.isEmpty() && savePng(path, bits, aScale)) {
+                return path;
             }
         }
     }
     return QString();
 }
+
+int
+FileUtils::saveToGalleryAsync(
+    QString aCode,
+    QString aSubDir,
+    QString aBaseName,
+    int aScale)
+{
+    return saveAllToGallery(QStringList(aCode), aSubDir, aBaseName, aScale);
+}
+
+int
+FileUtils::saveAllToGallery(
+    QStringList aCodes,
+    QString aSubDir,
+    QString aBaseName,
+    int aScale)
+{
+    // The codes are resolved right away, the registry entries may be
+    // gone by the time the task gets to run
+    QList<QByteArray> bits;
+    for (int i = 0; i < aCodes.count(); i++) {
+        bits.append(QrCodeRegistry::find(aCodes.at(i)));
+    }
+
+    // Zero is not a valid id
+    do { iPrivate->iLastId++; } while (!iPrivate->iLastId);
+    SaveTask* task = new SaveTask(iPrivate->iThreadPool, iPrivate->iLastId,
+        bits, aSubDir, aBaseName, aScale);
+
+    HDEBUG(task->iId << aCodes);
+    iPrivate->iTasks.append(task);
+    task->submit(this, SLOT(onSaveTaskDone()));
+    return task->iId;
+}
+
+void
+FileUtils::onSaveTaskDone()
+{
+    SaveTask* task = qobject_cast<SaveTask*>(sender());
+    if (task && iPrivate->iTasks.removeOne(task)) {
+        HDEBUG(task->iId << task->iPaths);
+        Q_EMIT saveFinished(task->iId, task->iPaths, task->iError);
+        task->release();
+    }
+}
+
+#include "FileUtils.moc"
@@ -42,7 +42,9 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QString>
+#include <QtCore/QStringList>
 
+class QIODevice;
 class QQmlEngine;
 class QJSEngine;
 
@@ -53,11 +55,47 @@ class FileUtils :
 
 public:
     FileUtils(QObject* aParent = Q_NULLPTR);
+    ~FileUtils();
 
+    // The code is either a QrCodeRegistry id or base32 encoded bits
     Q_INVOKABLE QString saveToGallery(QString, QString, QString, int);
 
+    // Same thing on a worker thread. The request id is returned right
+    // away, saveFinished() is emitted when the file has been written.
+    // The batch variant saves several codes in one go, the files are
+    // written in parallel.
+    Q_INVOKABLE int saveToGalleryAsync(QString, QString, QString, int);
+    Q_INVOKABLE int saveAllToGallery(QStringList, QString, QString, int);
+
+    // Writes 1-bit grayscale PNG with one module wide white border
+    static bool writePng(QIODevice*, const QByteArray&, int);
+    // Same thing, as SVG (black modules on white background)
+    static bool writeSvg(QIODevice*, const QByteArray&, int);
+
     // Callback for qmlRegisterSingletonType<FileUtils>
     static QObject* createSingleton(QQmlEngine*, QJSEngine*);
+
+Q_SIGNALS:
+    // Paths are in the same order as the codes, empty for the ones
+    // which couldn't be saved. The error is empty if all went well.
+    void saveFinished(int requestId, QStringList paths, QString error);
+
+private Q_SLOTS:
+    void onSaveTaskDone();
+
+private:
+    static QString galleryDir(const QString&);
+    static QString newFileName(const QString&, const QString&);
+    static bool savePng(const QString&, const QByteArray&, int);
+
+private:
+    class PngWriter;
+    class SaveTask;
+    class Private;
+    Private* iPrivate;
+
+public:
+    class FileNames;
 };
 
 #endif // FILE_UTILS_H
@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "QrCodeArena.h"
+
+#include "HarbourDebug.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+#include <QtCore/QVector>
+
+#include <algorithm>
+
+#include <string.h>
+
+// The prefix must be neither a valid base32 character nor the registry
+// id prefix
+#define QRCODE_ARENA_ID_PREFIX '~'
+#define QRCODE_ARENA_ID_BASE 36
+
+// ==========================================================================
+// QrCodeArena::Private
+// ==========================================================================
+
+class QrCodeArena::Private
+{
+public:
+    struct Slot {
+        int iOffset;
+        int iSize;
+    };
+
+    Private();
+
+    void compact();
+
+public:
+    QMutex iMutex;
+    QByteArray iData;
+    int iUsed;
+    quint32 iLastHandle;
+    QHash<quint32,Slot> iSlots;
+};
+
+Q_GLOBAL_STATIC(QrCodeArena::Private, qrCodeArena)
+
+QrCodeArena::Private::Private() :
+    iUsed(0),
+    iLastHandle(0)
+{
+}
+
+void
+QrCodeArena::Private::compact()
+{
+    // Slots keep their handles but move towards the beginning of the
+    // buffer, in the order of their offsets
+    QVector<QPair<int,quint32> > order;
+    order.reserve(iSlots.count());
+    for (QHash<quint32,Slot>::const_iterator it = iSlots.constBegin();
+         it != iSlots.constEnd(); ++it) {
+        order.append(qMakePair(it.value().iOffset, it.key()));
+    }
+    std::sort(order.begin(), order.end());
+
+    char* data = iData.data();
+    int offset = 0;
+    for (int i = 0; i < order.count(); i++) {
+        Slot& slot = iSlots[order.at(i).second];
+        if (slot.iOffset != offset) {
+            memmove(data + offset, data + slot.iOffset, slot.iSize);
+            slot.iOffset = offset;
+        }
+        offset += slot.iSize;
+    }
+    HDEBUG(iData.size() << "=>" << offset << "bytes");
+    iData.resize(offset);
+    iData.squeeze();
+    iUsed = offset;
+}
+
+// ==========================================================================
+// QrCodeArena
+// ==========================================================================
+
+quint32
+QrCodeArena::add(
+    const QByteArray& aBits)
+{
+    if (!aBits.isEmpty()) {
+        Private* arena = qrCodeArena();
+        QMutexLocker lock(&arena->iMutex);
+        Private::Slot slot;
+
+        do { arena->iLastHandle++; } while (!arena->iLastHandle ||
+            arena->iSlots.contains(arena->iLastHandle));
+        slot.iOffset = arena->iData.size();
+        slot.iSize = aBits.size();
+        arena->iData.append(aBits);
+        arena->iUsed += slot.iSize;
+        arena->iSlots.insert(arena->iLastHandle, slot);
+        return arena->iLastHandle;
+    }
+    return 0;
+}
+
+void
+QrCodeArena::remove(
+    quint32 aHandle)
+{
+    Private* arena = qrCodeArena();
+    QMutexLocker lock(&arena->iMutex);
+    QHash<quint32,Private::Slot>::iterator it = arena->iSlots.find(aHandle);
+
+    if (it != arena->iSlots.end()) {
+        arena->iUsed -= it.value().iSize;
+        arena->iSlots.erase(it);
+        if (arena->iUsed < arena->iData.size() / 2) {
+            arena->compact();
+        }
+    }
+}
+
+QByteArray
+QrCodeArena::bits(
+    quint32 aHandle)
+{
+    Private* arena = qrCodeArena();
+    QMutexLocker lock(&arena->iMutex);
+    QHash<quint32,Private::Slot>::const_iterator it =
+        arena->iSlots.constFind(aHandle);
+
+    // The buffer may move, the bits have to be copied
+    return (it != arena->iSlots.constEnd()) ?
+        QByteArray(arena->iData.constData() + it.value().iOffset,
+            it.value().iSize) : QByteArray();
+}
+
+QString
+QrCodeArena::id(
+    quint32 aHandle)
+{
+    return aHandle ? (QChar(QRCODE_ARENA_ID_PREFIX) +
+        QString::number(aHandle, QRCODE_ARENA_ID_BASE)) : QString();
+}
+
+bool
+QrCodeArena::isId(
+    const QString& aCode)
+{
+    return aCode.length() > 1 && aCode.at(0) == QChar(QRCODE_ARENA_ID_PREFIX);
+}
+
+QByteArray
+QrCodeArena::find(
+    const QString& aCode)
+{
+    if (isId(aCode)) {
+        bool ok;
+        const quint32 handle = aCode.mid(1).toUInt(&ok, QRCODE_ARENA_ID_BASE);
+        if (ok) {
+            return bits(handle);
+        }
+        HDEBUG("Invalid id" << aCode);
+    }
+    return QByteArray();
+}
+
+int
+QrCodeArena::size()
+{
+    Private* arena = qrCodeArena();
+    QMutexLocker lock(&arena->iMutex);
+
+    return arena->iUsed;
+}
+
+int
+QrCodeArena::capacity()
+{
+    Private* arena = qrCodeArena();
+    QMutexLocker lock(&arena->iMutex);
+
+    return arena->iData.capacity();
+}
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "QrCodeCache.h"
+
+#include "HarbourDebug.h"
+
+#include <QtCore/QCache>
+#include <QtCore/QHash>
+
+// ==========================================================================
+// QrCodeCache::Key
+// ==========================================================================
+
+class QrCodeCache::Key
+{
+public:
+    Key(const QString&, int, bool);
+
+    bool operator==(const Key&) const;
+    friend uint qHash(const Key& aKey, uint aSeed) { return aKey.iHash ^ aSeed; }
+
+public:
+    QString iText;
+    int iLevel;
+    bool iOptimal;
+    uint iHash;
+};
+
+QrCodeCache::Key::Key(
+    const QString& aText,
+    int aLevel,
+    bool aOptimal) :
+    iText(aText),
+    iLevel(aLevel),
+    iOptimal(aOptimal),
+    iHash(qHash(aText) ^ (aLevel << 1) ^ (aOptimal ? 1 : 0))
+{
+}
+
+inline
+bool
+QrCodeCache::Key::operator==(
+    const Key& aKey) const
+{
+    // Hash is compared first to avoid comparing long strings
+    return iHash == aKey.iHash && iLevel == aKey.iLevel &&
+        iOptimal == aKey.iOptimal && iText == aKey.iText;
+}
+
+// ==========================================================================
+// QrCodeCache::Private
+// ==========================================================================
+
+class QrCodeCache::Private
+{
+public:
+    class Entry {
+    public:
+        Entry(const QrCodeRegistry::Ref& aCode,
+            const QList<QrCodeRegistry::Ref>& aSequence) :
+            iCode(aCode), iSequence(aSequence) {}
+        QrCodeRegistry::Ref iCode;
+        QList<QrCodeRegistry::Ref> iSequence;
+    };
+
+    Private(int);
+
+    static int cost(const Key&, const Entry*);
+    void evicted(int);
+
+public:
+    QCache<Key,Entry> iCache;
+    uint iHits;
+    uint iMisses;
+    uint iEvictions;
+};
+
+QrCodeCache::Private::Private(
+    int aCapacity) :
+    iCache(qMax(aCapacity, 0)),
+    iHits(0),
+    iMisses(0),
+    iEvictions(0)
+{
+}
+
+int
+QrCodeCache::Private::cost(
+    const Key& aKey,
+    const Entry* aEntry)
+{
+    // The text is shared by all levels, but is counted for each of
+    // them. That overestimates the footprint, never underestimates it.
+    // The first symbol of a sequence is also counted twice.
+    int bytes = sizeof(Key) + sizeof(Entry) + aEntry->iCode.bits().size() +
+        aKey.iText.size() * sizeof(QChar);
+    for (int i = 0; i < aEntry->iSequence.count(); i++) {
+        bytes += sizeof(QrCodeRegistry::Ref) +
+            aEntry->iSequence.at(i).bits().size();
+    }
+    return bytes;
+}
+
+void
+QrCodeCache::Private::evicted(
+    int aCount)
+{
+    if (aCount > 0) {
+        HDEBUG(aCount << "evicted," << iCache.totalCost() << "bytes used");
+        iEvictions += aCount;
+    }
+}
+
+// ==========================================================================
+// QrCodeCache
+// ==========================================================================
+
+QrCodeCache::QrCodeCache(
+    int aCapacity) :
+    iPrivate(new Private(aCapacity))
+{
+}
+
+QrCodeCache::~QrCodeCache()
+{
+    delete iPrivate;
+}
+
+int
+QrCodeCache::capacity() const
+{
+    return iPrivate->iCache.maxCost();
+}
+
+void
+QrCodeCache::setCapacity(
+    int aCapacity)
+{
+    const int prevCount = iPrivate->iCache.count();
+
+    iPrivate->iCache.setMaxCost(qMax(aCapacity, 0));
+    iPrivate->evicted(prevCount - iPrivate->iCache.count());
+}
+
+int
+QrCodeCache::size() const
+{
+    return iPrivate->iCache.totalCost();
+}
+
+bool
+QrCodeCache::find(
+    const QString& aText,
+    int aLevel,
+    bool aOptimal,
+    QrCodeRegistry::Ref* aCode,
+    QList<QrCodeRegistry::Ref>* aSequence)
+{
+    // QCache::object() moves the entry to the front of the LRU list
+    const Private::Entry* entry = iPrivate->iCache.object(Key(aText,
+        aLevel, aOptimal));
+    if (entry) {
+        iPrivate->iHits++;
+        if (aCode) {
+            *aCode = entry->iCode;
+        }
+        if (aSequence) {
+            *aSequence = entry->iSequence;
+        }
+        return true;
+    } else {
+        iPrivate->iMisses++;
+        return false;
+    }
+}
+
+void
+QrCodeCache::insert(
+    const QString& aText,
+    int aLevel,
+    bool aOptimal,
+    const QrCodeRegistry::Ref& aCode,
+    const QList<QrCodeRegistry::Ref>& aSequence)
+{
+    const Key key(aText, aLevel, aOptimal);
+    Private::Entry* entry = new Private::Entry(aCode, aSequence);
+    const int cost = Private::cost(key, entry);
+    const int prevCount = iPrivate->iCache.count() -
+        (iPrivate->iCache.contains(key) ? 1 : 0);
+
+    // QCache takes the ownership of the entry (and deletes it if
+    // it doesn't fit at all)
+    const bool inserted = iPrivate->iCache.insert(key, entry, cost);
+    iPrivate->evicted(prevCount + (inserted ? 1 : 0) - iPrivate->iCache.count());
+}
+
+void
+QrCodeCache::clear()
+{
+    iPrivate->iCache.clear();
+}
+
+uint
+QrCodeCache::hits() const
+{
+    return iPrivate->iHits;
+}
+
+uint
+QrCodeCache::misses() const
+{
+    return iPrivate->iMisses;
+}
+
+uint
+QrCodeCache::evictions() const
+{
+    return iPrivate->iEvictions;
+}
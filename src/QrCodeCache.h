@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#ifndef QRCODE_CACHE_H
+#define QRCODE_CACHE_H
+
+#include "QrCodeRegistry.h"
+
+#include <QtCore/QList>
+
+// LRU cache of generated codes keyed by (text, EC level, segmentation),
+// where the segmentation is either optimal or greedy (see QrCodeGenerator).
+// Empty codes (text too long for the level) are cached too, and so are
+// structured append sequences. Not thread-safe, meant to be used by the
+// thread which owns the model.
+class QrCodeCache
+{
+    Q_DISABLE_COPY(QrCodeCache)
+
+public:
+    static const int DefaultCapacity = 0x100000; // bytes
+
+    QrCodeCache(int aCapacity = DefaultCapacity);
+    ~QrCodeCache();
+
+    int capacity() const;
+    void setCapacity(int);
+    int size() const;
+
+    bool find(const QString&, int, bool, QrCodeRegistry::Ref*,
+        QList<QrCodeRegistry::Ref>* aSequence = Q_NULLPTR);
+    void insert(const QString&, int, bool, const QrCodeRegistry::Ref&,
+        const QList<QrCodeRegistry::Ref>& aSequence =
+            QList<QrCodeRegistry::Ref>());
+    void clear();
+
+    uint hits() const;
+    uint misses() const;
+    uint evictions() const;
+
+private:
+    class Key;
+    class Private;
+    Private* iPrivate;
+};
+
+#endif // QRCODE_CACHE_H
@@ -0,0 +1,966 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "QrCodeGenerator.h"
+#include "QrCodeScheduler.h"
+
+#include "qrclip.h"
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTextCodec>
+#include <QtCore/QVector>
+
+#include <limits.h>
+#include <string.h>
+
+// Internal libqrencode headers
+extern "C" {
+#include "mqrspec.h"
+#include "qrinput.h"
+#include "qrspec.h"
+#include "split.h"
+}
+
+// ECI assignment number for UTF-8
+#define QRCODE_ECI_UTF8 (26)
+
+// Versions sharing the same sizes of the character count fields
+static const struct QrCodeVersionRange {
+    int iMin;
+    int iMax;
+} qrCodeVersionRanges[] = { { 1, 9 }, { 10, 26 }, { 27, QRSPEC_VERSION_MAX } };
+
+// ==========================================================================
+// QrCodeGenerator::ArenaScope
+//
+// Everything libqrencode allocates while generating a code comes from
+// the per-thread arena and is released in bulk at the end of the scope.
+// Nothing allocated by the encoder may outlive it.
+// ==========================================================================
+
+class QrCodeGenerator::ArenaScope
+{
+public:
+    ArenaScope() { QRclip_arenaBegin(); }
+    ~ArenaScope() { QRclip_arenaEnd(); }
+};
+
+// ==========================================================================
+// QrCodeGenerator::CancelScope
+// ==========================================================================
+
+class QrCodeGenerator::CancelScope
+{
+public:
+    CancelScope(const CancelToken* aToken) : iToken(aToken)
+        { if (iToken) QRclip_setCancelFunc(isCanceled, (void*)iToken); }
+    ~CancelScope()
+        { if (iToken) QRclip_setCancelFunc(Q_NULLPTR, Q_NULLPTR); }
+
+private:
+    static int isCanceled(void* aToken)
+        { return ((const CancelToken*)aToken)->isCanceled(); }
+
+private:
+    const CancelToken* iToken;
+};
+
+// ==========================================================================
+// QrCodeGenerator::ParallelScope
+// ==========================================================================
+
+static QAtomicInt qrCodeParallelMaskVersion;
+
+class QrCodeGenerator::ParallelScope
+{
+public:
+    ParallelScope() : iVersion(qrCodeParallelMaskVersion.load())
+        { if (iVersion > 0) QRclip_setParallelFunc(run, Q_NULLPTR, iVersion); }
+    ~ParallelScope()
+        { if (iVersion > 0) QRclip_setParallelFunc(Q_NULLPTR, Q_NULLPTR, 0); }
+
+private:
+    class MaskJob;
+    static void run(QRclipJobFunc, void*, int, void*);
+
+private:
+    const int iVersion;
+};
+
+class QrCodeGenerator::ParallelScope::MaskJob :
+    public QrCodeScheduler::Job
+{
+public:
+    MaskJob(QRclipJobFunc aJob, void* aData, int aIndex) :
+        iJob(aJob), iData(aData), iIndex(aIndex) {}
+    void perform() Q_DECL_OVERRIDE { iJob(iData, iIndex); }
+
+private:
+    const QRclipJobFunc iJob;
+    void* const iData;
+    const int iIndex;
+};
+
+void
+QrCodeGenerator::ParallelScope::run(
+    QRclipJobFunc aJob,
+    void* aData,
+    int aCount,
+    void*)
+{
+    // The first job is run on this thread, the rest are handed over
+    // to the pool with the priority of whatever this thread is running.
+    // The ones which haven't started by the time they are waited for
+    // get run on this thread too.
+    QVector<MaskJob*> jobs;
+
+    jobs.reserve(aCount);
+    for (int i = 1; i < aCount; i++) {
+        MaskJob* job = new MaskJob(aJob, aData, i);
+        job->start();
+        jobs.append(job);
+    }
+    aJob(aData, 0);
+    for (int i = 0; i < jobs.count(); i++) {
+        jobs.at(i)->wait();
+        jobs.at(i)->release();
+    }
+}
+
+// ==========================================================================
+// QrCodeGenerator::Segmenter
+//
+// Finds the sequence of segments which takes the least number of bits,
+// by dynamic programming over the characters and the four modes (the
+// well-known algorithm from Project Nayuki's QR Code generator). Byte
+// segments are UTF-8, which is announced with an ECI header if there's
+// anything other than ASCII in them. Characters which can be converted
+// to Shift JIS and back (which is what readers do) are also eligible
+// for the kanji mode.
+// ==========================================================================
+
+class QrCodeGenerator::Segmenter
+{
+public:
+    Segmenter(const QString&);
+
+    QRinput* createInput(int, int*) const;
+    static int dataBits(int, int);
+    static int minBits(const QString&, int, int);
+
+private:
+    enum {
+        ModeCount = QR_MODE_KANJI + 1,  // NUM, AN, 8 and KANJI
+        NoMode = 0xff
+    };
+
+    struct Char {
+        int iOffset;        // In iUtf8
+        uchar iBytes;       // UTF-8 length
+        uchar iModes;       // Bitmask of modes which can encode it
+        char iSjis[2];      // Kanji mode only
+    };
+
+    static int charCost(int, const Char&);
+    static void advance(const Char&, const int*, int*, uchar*);
+    QVector<uchar> modes(int) const;
+
+private:
+    QByteArray iUtf8;
+    QVector<Char> iChars;
+};
+
+QrCodeGenerator::Segmenter::Segmenter(
+    const QString& aText)
+{
+    static const char alnum[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:";
+    QTextCodec* sjis = QTextCodec::codecForName("Shift-JIS");
+    const int n = aText.length();
+    const QChar* text = aText.constData();
+
+    iUtf8.reserve(n);
+    iChars.reserve(n);
+    for (int i = 0; i < n; i++) {
+        Char c;
+        uint ucs4 = text[i].unicode();
+
+        c.iOffset = iUtf8.size();
+        c.iModes = (1 << QR_MODE_8);
+        c.iSjis[0] = c.iSjis[1] = 0;
+        if (ucs4 < 0x80) {
+            iUtf8.append((char)ucs4);
+            if (ucs4 >= '0' && ucs4 <= '9') {
+                c.iModes |= (1 << QR_MODE_NUM);
+            }
+            if (ucs4 && strchr(alnum, ucs4)) {
+                c.iModes |= (1 << QR_MODE_AN);
+            }
+        } else {
+            if (text[i].isHighSurrogate() && (i + 1) < n &&
+                text[i + 1].isLowSurrogate()) {
+                ucs4 = QChar::surrogateToUcs4(text[i], text[i + 1]);
+                i++;
+            } else if (text[i].isSurrogate()) {
+                // Same thing QString::toUtf8() does
+                ucs4 = QChar::ReplacementCharacter;
+            } else if (sjis) {
+                const QByteArray sj(sjis->fromUnicode(text + i, 1));
+                if (sj.size() == 2 && sjis->toUnicode(sj) == QString(text[i])) {
+                    const uint code = ((uchar)sj.at(0) << 8) | (uchar)sj.at(1);
+                    if ((code >= 0x8140 && code <= 0x9ffc) ||
+                        (code >= 0xe040 && code <= 0xebbf)) {
+                        c.iModes |= (1 << QR_MODE_KANJI);
+                        c.iSjis[0] = sj.at(0);
+                        c.iSjis[1] = sj.at(1);
+                    }
+                }
+            }
+            if (ucs4 < 0x800) {
+                iUtf8.append((char)(0xc0 | (ucs4 >> 6)));
+            } else {
+                if (ucs4 < 0x10000) {
+                    iUtf8.append((char)(0xe0 | (ucs4 >> 12)));
+                } else {
+                    iUtf8.append((char)(0xf0 | (ucs4 >> 18)));
+                    iUtf8.append((char)(0x80 | ((ucs4 >> 12) & 0x3f)));
+                }
+                iUtf8.append((char)(0x80 | ((ucs4 >> 6) & 0x3f)));
+            }
+            iUtf8.append((char)(0x80 | (ucs4 & 0x3f)));
+        }
+        c.iBytes = (uchar)(iUtf8.size() - c.iOffset);
+        iChars.append(c);
+    }
+}
+
+inline
+int
+QrCodeGenerator::Segmenter::charCost(
+    int aMode,
+    const Char& aChar)
+{
+    // In 1/6 of a bit, so that the numeric (10 bits per 3 characters)
+    // and alphanumeric (11 bits per 2 characters) costs are integers
+    switch (aMode) {
+    case QR_MODE_NUM: return 20;
+    case QR_MODE_AN: return 33;
+    case QR_MODE_KANJI: return 78;
+    }
+    return aChar.iBytes * 8 * 6;
+}
+
+int
+QrCodeGenerator::Segmenter::dataBits(
+    int aMode,
+    int aCount)
+{
+    // Same as QRinput_estimateBits* in libqrencode/qrinput.c
+    static const int numTail[] = { 0, 4, 7 };
+
+    switch (aMode) {
+    case QR_MODE_NUM: return (aCount / 3) * 10 + numTail[aCount % 3];
+    case QR_MODE_AN: return (aCount / 2) * 11 + (aCount % 2) * 6;
+    case QR_MODE_KANJI: return aCount * 13;
+    }
+    return aCount * 8;
+}
+
+void
+QrCodeGenerator::Segmenter::advance(
+    const Char& aChar,
+    const int* aHead,
+    int* aCost,
+    uchar* aPrev)
+{
+    // Costs of ending up in each mode after the next character. The
+    // previous modes are only stored if aPrev isn't NULL.
+    static const int Inf = INT_MAX / 2;
+    int extend[ModeCount];
+
+    // Append the character to the open segment...
+    for (int m = 0; m < ModeCount; m++) {
+        if (aChar.iModes & (1 << m)) {
+            extend[m] = aCost[m] + charCost(m, aChar);
+            if (aPrev) aPrev[m] = (uchar)m;
+        } else {
+            extend[m] = Inf;
+            if (aPrev) aPrev[m] = NoMode;
+        }
+        aCost[m] = extend[m];
+    }
+
+    // ...and possibly start a new one right after it
+    for (int to = 0; to < ModeCount; to++) {
+        for (int m = 0; m < ModeCount; m++) {
+            if (m != to && extend[m] < Inf) {
+                const int switched = (extend[m] + 5) / 6 * 6 + aHead[to];
+                if (switched < aCost[to]) {
+                    aCost[to] = switched;
+                    if (aPrev) aPrev[to] = (uchar)m;
+                }
+            }
+        }
+    }
+}
+
+int
+QrCodeGenerator::Segmenter::minBits(
+    const QString& aText,
+    int aVersion,
+    int aLimit)
+{
+    static const char alnum[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:";
+    const int n = aText.length();
+    const QChar* text = aText.constData();
+    int head[ModeCount], cost[ModeCount], best = INT_MAX;
+
+    // Same thing as modes() minus the traceback, and the characters
+    // are classified on the fly. Shift JIS conversion is what makes the
+    // constructor expensive, so any non-ASCII character (except for the
+    // ones outside of the BMP) is assumed to be eligible for the kanji
+    // mode. The ECI header is ignored too. The costs only grow, so it
+    // stops as soon as all of them are over the limit.
+    for (int m = 0; m < ModeCount; m++) {
+        head[m] = (4 + QRspec_lengthIndicator((QRencodeMode)m, aVersion)) * 6;
+        cost[m] = head[m];
+        best = qMin(best, cost[m]);
+    }
+
+    for (int i = 0; i < n && best <= aLimit * 6; i++) {
+        const uint ucs4 = text[i].unicode();
+        Char c;
+
+        c.iModes = (1 << QR_MODE_8);
+        if (ucs4 < 0x80) {
+            c.iBytes = 1;
+            if (ucs4 >= '0' && ucs4 <= '9') {
+                c.iModes |= (1 << QR_MODE_NUM);
+            }
+            if (ucs4 && strchr(alnum, ucs4)) {
+                c.iModes |= (1 << QR_MODE_AN);
+            }
+        } else if (text[i].isHighSurrogate() && (i + 1) < n &&
+            text[i + 1].isLowSurrogate()) {
+            c.iBytes = 4;
+            i++;
+        } else {
+            c.iBytes = (ucs4 < 0x800) ? 2 : 3;
+            if (!text[i].isSurrogate()) {
+                c.iModes |= (1 << QR_MODE_KANJI);
+            }
+        }
+        advance(c, head, cost, Q_NULLPTR);
+        best = cost[0];
+        for (int m = 1; m < ModeCount; m++) {
+            best = qMin(best, cost[m]);
+        }
+    }
+    return (best + 5) / 6;
+}
+
+QVector<uchar>
+QrCodeGenerator::Segmenter::modes(
+    int aVersion) const
+{
+    const int n = iChars.count();
+    int head[ModeCount], cost[ModeCount];
+
+    // Mode of the character i if the segment which is open after it
+    // is in mode m is stored in from[i * ModeCount + m]
+    QVector<uchar> from(n * ModeCount);
+    for (int m = 0; m < ModeCount; m++) {
+        head[m] = (4 + QRspec_lengthIndicator((QRencodeMode)m, aVersion)) * 6;
+        cost[m] = head[m];
+    }
+
+    uchar* prev = from.data();
+    for (int i = 0; i < n; i++, prev += ModeCount) {
+        advance(iChars.at(i), head, cost, prev);
+    }
+
+    // Pick the cheapest final state and trace the modes back from there
+    QVector<uchar> modes(n);
+    int state = 0;
+    for (int m = 1; m < ModeCount; m++) {
+        if (cost[m] < cost[state]) {
+            state = m;
+        }
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        state = from.at(i * ModeCount + state);
+        modes[i] = (uchar)state;
+    }
+    return modes;
+}
+
+QRinput*
+QrCodeGenerator::Segmenter::createInput(
+    int aVersion,
+    int* aBits) const
+{
+    const QVector<uchar> m(modes(aVersion));
+    const int n = iChars.count();
+    QRinput* input = QRinput_new();
+    int bits = 0;
+    int ok = 0;
+
+    if (input) {
+        // ECI is only needed if there's non-ASCII in the byte segments
+        for (int i = 0; i < n; i++) {
+            if (m.at(i) == QR_MODE_8 && iChars.at(i).iBytes > 1) {
+                ok = QRinput_appendECIheader(input, QRCODE_ECI_UTF8);
+                bits += 4 + 8;
+                break;
+            }
+        }
+
+        for (int i = 0; i < n && ok == 0;) {
+            const QRencodeMode mode = (QRencodeMode)m.at(i);
+            const Char& first = iChars.at(i);
+            QByteArray data;
+            int count = 0;
+
+            if (mode == QR_MODE_KANJI) {
+                for (; i < n && m.at(i) == mode; i++, count++) {
+                    data.append(iChars.at(i).iSjis, 2);
+                }
+            } else {
+                for (; i < n && m.at(i) == mode; i++, count++);
+                const Char& last = iChars.at(i - 1);
+                data = iUtf8.mid(first.iOffset, last.iOffset + last.iBytes -
+                    first.iOffset);
+                if (mode == QR_MODE_8) {
+                    count = data.size();
+                }
+            }
+            bits += 4 + QRspec_lengthIndicator(mode, aVersion) +
+                dataBits(mode, count);
+            ok = QRinput_append(input, mode, data.size(),
+                (const unsigned char*)data.constData());
+        }
+
+        if (ok != 0) {
+            QRinput_free(input);
+            input = Q_NULLPTR;
+        }
+    }
+    *aBits = bits;
+    return input;
+}
+
+// ==========================================================================
+// QrCodeGenerator::Input
+// ==========================================================================
+
+QrCodeGenerator::Input::Input(
+    const QString& aText,
+    Segmentation aSegmentation) :
+    iSegmentation(aSegmentation)
+{
+    for (int r = 0; r < VersionRanges; r++) {
+        iInput[r] = Q_NULLPTR;
+        iBits[r] = 0;
+    }
+    if (!aText.isEmpty()) {
+        if (aSegmentation == SegmentationOptimal) {
+            const Segmenter segmenter(aText);
+            for (int r = 0; r < VersionRanges; r++) {
+                iInput[r] = segmenter.createInput(qrCodeVersionRanges[r].iMin,
+                    iBits + r);
+            }
+        } else {
+            // Same as QRcode_encodeString(text, 0, level, QR_MODE_8, 1)
+            // would do, minus the EC level which gets set later for each
+            // copy. The version is chosen by libqrencode.
+            const QByteArray utf8(aText.toUtf8());
+            QRinput* input = QRinput_new();
+            if (input && Split_splitStringToQRinput(utf8.constData(),
+                input, QR_MODE_8, 1) < 0) {
+                QRinput_free(input);
+                input = Q_NULLPTR;
+            }
+            iInput[0] = input;
+        }
+    }
+}
+
+QrCodeGenerator::Input::~Input()
+{
+    for (int r = 0; r < VersionRanges; r++) {
+        if (iInput[r]) QRinput_free(iInput[r]);
+    }
+}
+
+bool
+QrCodeGenerator::Input::isValid() const
+{
+    for (int r = 0; r < VersionRanges; r++) {
+        if (iInput[r]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QRinput*
+QrCodeGenerator::Input::input(
+    HarbourQrCodeGenerator::ECLevel aLevel,
+    int* aVersion) const
+{
+    if (iSegmentation == SegmentationOptimal) {
+        // The smallest version which has enough room for the segments
+        // optimized for its range
+        for (int r = 0; r < VersionRanges; r++) {
+            if (iInput[r]) {
+                const QrCodeVersionRange* range = qrCodeVersionRanges + r;
+                for (int v = range->iMin; v <= range->iMax; v++) {
+                    if (QRspec_getDataLength(v, (QRecLevel)aLevel) * 8 >= iBits[r]) {
+                        *aVersion = v;
+                        return iInput[r];
+                    }
+                }
+            }
+        }
+        return Q_NULLPTR;
+    } else {
+        *aVersion = 0;
+        return iInput[0];
+    }
+}
+
+QRinput*
+QrCodeGenerator::Input::input(
+    int aVersion) const
+{
+    if (iSegmentation == SegmentationOptimal) {
+        // Segments optimized for the range which includes this version
+        for (int r = 0; r < VersionRanges; r++) {
+            if (aVersion <= qrCodeVersionRanges[r].iMax) {
+                return iInput[r];
+            }
+        }
+        return Q_NULLPTR;
+    } else {
+        return iInput[0];
+    }
+}
+
+// ==========================================================================
+// QrCodeGenerator::Capacity
+// ==========================================================================
+
+// Structured append header: mode, position, total and parity
+#define QRCODE_SA_HEADER_BITS (4 + 4 + 4 + 8)
+
+QrCodeGenerator::Capacity::Capacity(
+    const QString& aText)
+{
+    // There's no point in counting beyond the longest possible sequence
+    const int limit = QRspec_getDataLength(QRSPEC_VERSION_MAX, QR_ECLEVEL_L) *
+        8 * Sequence::MaxCount;
+
+    for (int r = 0; r < VersionRanges; r++) {
+        iBits[r] = Segmenter::minBits(aText, qrCodeVersionRanges[r].iMin, limit);
+    }
+}
+
+int
+QrCodeGenerator::Capacity::bits(
+    int aVersion) const
+{
+    for (int r = 0; r < VersionRanges; r++) {
+        if (aVersion <= qrCodeVersionRanges[r].iMax) {
+            return iBits[r];
+        }
+    }
+    return iBits[VersionRanges - 1];
+}
+
+int
+QrCodeGenerator::Capacity::version(
+    HarbourQrCodeGenerator::ECLevel aLevel) const
+{
+    // Same criteria as Input::input() uses
+    for (int r = 0; r < VersionRanges; r++) {
+        const QrCodeVersionRange* range = qrCodeVersionRanges + r;
+        for (int v = range->iMin; v <= range->iMax; v++) {
+            if (QRspec_getDataLength(v, (QRecLevel)aLevel) * 8 >= iBits[r]) {
+                return v;
+            }
+        }
+    }
+    return 0;
+}
+
+int
+QrCodeGenerator::Capacity::symbols(
+    HarbourQrCodeGenerator::ECLevel aLevel,
+    int aVersion) const
+{
+    const int v = qBound(1, aVersion, (int)MaxVersion);
+    const int capacity = QRspec_getDataLength(v, (QRecLevel)aLevel) * 8;
+    const int n = bits(v);
+
+    // Each symbol of a sequence starts with the header
+    if (n <= capacity) {
+        return 1;
+    } else {
+        const int room = capacity - QRCODE_SA_HEADER_BITS;
+        return (n + room - 1) / room;
+    }
+}
+
+// ==========================================================================
+// QrCodeGenerator::Sequence
+// ==========================================================================
+
+QrCodeGenerator::Sequence::Sequence(
+    const Input& aInput,
+    HarbourQrCodeGenerator::ECLevel aLevel,
+    int aMaxVersion) :
+    iStruct(Q_NULLPTR),
+    iVersion(0)
+{
+    // Splitting is cheap compared to encoding, so the versions are
+    // simply tried from the largest one down, until the number of
+    // symbols goes up
+    for (int v = qBound(1, aMaxVersion, QRSPEC_VERSION_MAX); v > 0; v--) {
+        QRinput* shared = aInput.input(v);
+        QRinput* input = shared ? QRinput_dup(shared) : Q_NULLPTR;
+        QRinput_Struct* split = Q_NULLPTR;
+
+        if (input) {
+            if (QRinput_setVersion(input, v) == 0 &&
+                QRinput_setErrorCorrectionLevel(input, (QRecLevel)aLevel) == 0) {
+                // Calculates the parity and inserts the headers too
+                split = QRinput_splitQRinputToStruct(input);
+            }
+            QRinput_free(input);
+        }
+        if (split && (!iStruct || split->size <= iStruct->size)) {
+            if (iStruct) QRinput_Struct_free(iStruct);
+            iStruct = split;
+            iVersion = v;
+            if (iStruct->size == 1) {
+                // Fits into a single symbol, no need to split it
+                break;
+            }
+        } else {
+            if (split) QRinput_Struct_free(split);
+            break;
+        }
+    }
+
+    if (iStruct) {
+        for (QRinput_InputList* l = iStruct->head; l; l = l->next) {
+            iSymbols.append(l->input);
+        }
+    }
+}
+
+QrCodeGenerator::Sequence::~Sequence()
+{
+    if (iStruct) QRinput_Struct_free(iStruct);
+}
+
+int
+QrCodeGenerator::Sequence::count() const
+{
+    return iSymbols.count();
+}
+
+int
+QrCodeGenerator::Sequence::version() const
+{
+    return iVersion;
+}
+
+// ==========================================================================
+// QrCodeGenerator
+// ==========================================================================
+
+QByteArray
+QrCodeGenerator::encode(
+    QRinput* aInput,
+    const CancelToken* aCancel,
+    Timing* aTiming)
+{
+    QByteArray bits;
+    QElapsedTimer timer;
+
+    if (aTiming) timer.start();
+    CancelScope scope(aCancel);
+    ParallelScope parallel;
+    QRcode* code = QRcode_encodeInput(aInput);
+
+    // Micro QR doesn't fail on cancel, it may return garbage instead
+    if (code && aCancel && aCancel->isCanceled()) {
+        QRcode_free(code);
+        code = Q_NULLPTR;
+    }
+    if (code) {
+        const qint64 packStart = aTiming ? timer.nsecsElapsed() : 0;
+
+        // Pack the modules, MSB first, each row padded to a byte
+        const int width = code->width;
+        const int bpl = (width + 7) / 8;
+        const uchar* src = code->data;
+
+        bits.fill(0, bpl * width);
+        uchar* dest = (uchar*)bits.data();
+        for (int y = 0; y < width; y++, dest += bpl) {
+            for (int x = 0; x < width; x++) {
+                if (*src++ & 1) {
+                    dest[x / 8] |= (uchar)(0x80 >> (x % 8));
+                }
+            }
+        }
+        QRcode_free(code);
+        if (aTiming) {
+            aTiming->iPack = timer.nsecsElapsed() - packStart;
+        }
+    }
+    if (aTiming) {
+        aTiming->iEncode = timer.nsecsElapsed();
+    }
+    return bits;
+}
+
+int
+QrCodeGenerator::microMode(
+    const QString& aText,
+    int* aSize)
+{
+    static const char alnum[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:";
+    const int n = aText.length();
+    const QChar* text = aText.constData();
+    QRencodeMode mode = QR_MODE_NUM;
+
+    // Micro QR is for short texts, which typically don't need mixing
+    // the modes. The whole thing goes into the cheapest single segment.
+    // There's no ECI in Micro QR, the byte mode is plain UTF-8.
+    for (int i = 0; i < n && mode != QR_MODE_8; i++) {
+        const uint c = text[i].unicode();
+        if (c >= 0x80 || !c || !strchr(alnum, c)) {
+            mode = QR_MODE_8;
+        } else if (c < '0' || c > '9') {
+            mode = QR_MODE_AN;
+        }
+    }
+
+    // One byte per character unless it's the byte mode anyway, in which
+    // case it's the length of what QString::toUtf8() would produce
+    int size = n;
+    if (mode == QR_MODE_8) {
+        size = 0;
+        for (int i = 0; i < n; i++) {
+            const uint c = text[i].unicode();
+            if (c < 0x80) {
+                size += 1;
+            } else if (c < 0x800) {
+                size += 2;
+            } else if (text[i].isHighSurrogate() && (i + 1) < n &&
+                text[i + 1].isLowSurrogate()) {
+                size += 4;
+                i++;
+            } else {
+                // Including the replacement for a lone surrogate
+                size += 3;
+            }
+        }
+    }
+    *aSize = size;
+    return mode;
+}
+
+int
+QrCodeGenerator::microFit(
+    int aMode,
+    int aSize,
+    HarbourQrCodeGenerator::ECLevel aLevel)
+{
+    const QRencodeMode mode = (QRencodeMode)aMode;
+    const int bits = Segmenter::dataBits(mode, aSize);
+
+    // Mode indicator takes (version - 1) bits. Zero length indicator
+    // means that the mode isn't supported by the version, zero capacity
+    // that the level isn't.
+    for (int v = 1; aSize > 0 && v <= MQRSPEC_VERSION_MAX; v++) {
+        const int lengthBits = MQRspec_lengthIndicator(mode, v);
+        const int capacity = MQRspec_getDataLengthBit(v, (QRecLevel)aLevel);
+        if (lengthBits && capacity &&
+            aSize <= MQRspec_maximumWords(mode, v) &&
+            (v - 1) + lengthBits + bits <= capacity) {
+            return v;
+        }
+    }
+    return 0;
+}
+
+QRinput*
+QrCodeGenerator::microInput(
+    const QString& aText,
+    HarbourQrCodeGenerator::ECLevel aLevel,
+    int* aVersion)
+{
+    int size = 0;
+    const QRencodeMode mode = (QRencodeMode)microMode(aText, &size);
+    const int version = microFit(mode, size, aLevel);
+    QRinput* input = Q_NULLPTR;
+
+    if (version) {
+        const QByteArray data((mode == QR_MODE_8) ? aText.toUtf8() :
+            aText.toLatin1());
+        input = QRinput_newMQR(version, (QRecLevel)aLevel);
+        if (input && QRinput_append(input, mode, data.size(),
+            (const unsigned char*)data.constData()) != 0) {
+            QRinput_free(input);
+            input = Q_NULLPTR;
+        }
+    }
+    *aVersion = input ? version : 0;
+    return input;
+}
+
+int
+QrCodeGenerator::microVersion(
+    const QString& aText,
+    HarbourQrCodeGenerator::ECLevel aLevel)
+{
+    int size = 0;
+    const int mode = microMode(aText, &size);
+    return microFit(mode, size, aLevel);
+}
+
+QByteArray
+QrCodeGenerator::generateMicro(
+    const QString& aText,
+    HarbourQrCodeGenerator::ECLevel aLevel,
+    const CancelToken* aCancel,
+    Timing* aTiming)
+{
+    ArenaScope arena;
+    QByteArray bits;
+    int version = 0;
+    QRinput* input = microInput(aText, aLevel, &version);
+
+    if (input) {
+        bits = encode(input, aCancel, aTiming);
+        QRinput_free(input);
+    }
+    return bits;
+}
+
+QByteArray
+QrCodeGenerator::generate(
+    const Input& aInput,
+    HarbourQrCodeGenerator::ECLevel aLevel,
+    const CancelToken* aCancel,
+    Timing* aTiming)
+{
+    ArenaScope arena;
+    QByteArray bits;
+    int version = 0;
+
+    // Encoding may split the segments which don't fit into the chosen
+    // version, so each level gets its own copy of the shared input
+    QRinput* shared = aInput.input(aLevel, &version);
+    QRinput* input = shared ? QRinput_dup(shared) : Q_NULLPTR;
+    if (input) {
+        if (QRinput_setVersion(input, version) == 0 &&
+            QRinput_setErrorCorrectionLevel(input, (QRecLevel)aLevel) == 0) {
+            bits = encode(input, aCancel, aTiming);
+        }
+        QRinput_free(input);
+    }
+    return bits;
+}
+
+QByteArray
+QrCodeGenerator::generate(
+    const Sequence& aSequence,
+    int aIndex,
+    const CancelToken* aCancel,
+    Timing* aTiming)
+{
+    ArenaScope arena;
+    QByteArray bits;
+
+    // Version, level and the structured append header are already there
+    if (aIndex >= 0 && aIndex < aSequence.iSymbols.count()) {
+        QRinput* input = QRinput_dup(aSequence.iSymbols.at(aIndex));
+        if (input) {
+            bits = encode(input, aCancel, aTiming);
+            QRinput_free(input);
+        }
+    }
+    return bits;
+}
+
+int
+QrCodeGenerator::parallelMaskVersion()
+{
+    return qrCodeParallelMaskVersion.load();
+}
+
+void
+QrCodeGenerator::setParallelMaskVersion(
+    int aVersion)
+{
+    qrCodeParallelMaskVersion.store(qBound(0, aVersion, (int)MaxVersion));
+}
+
+QByteArray
+QrCodeGenerator::generate(
+    const QString& aText,
+    HarbourQrCodeGenerator::ECLevel aLevel,
+    const CancelToken* aCancel)
+{
+    return generate(Input(aText), aLevel, aCancel);
+}
+
+QByteArray
+QrCodeGenerator::generate(
+    const QString& aText,
+    HarbourQrCodeGenerator::ECLevel aLevel,
+    Segmentation aSegmentation,
+    const CancelToken* aCancel)
+{
+    return generate(Input(aText, aSegmentation), aLevel, aCancel);
+}
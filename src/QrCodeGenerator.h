@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#ifndef QRCODE_GENERATOR_H
+#define QRCODE_GENERATOR_H
+
+#include "HarbourQrCodeGenerator.h"
+
+#include <QtCore/QList>
+
+struct _QRinput;
+struct _QRinput_Struct;
+
+// Same codes as HarbourQrCodeGenerator::generate() produces (unless
+// the optimal segmentation is requested), but the generation can be
+// interrupted half-way through and the input analysis can be shared
+// between EC levels. The token is polled by libqrencode at its
+// checkpoints, on the thread calling generate(). An empty array is
+// returned if the code can't be generated or the generation has been
+// canceled. Whatever libqrencode allocates while generating a code
+// comes from a per-thread arena, which is reused from one code to
+// another and doesn't touch the heap once it has warmed up.
+class QrCodeGenerator
+{
+    // Optimal segments depend on the sizes of the character count
+    // fields, i.e. on the range of versions (1-9, 10-26 and 27-40)
+    enum { VersionRanges = 3 };
+
+public:
+    enum { MaxVersion = 40 };
+    enum { MicroMaxVersion = 4 };
+
+    enum Segmentation {
+        // libqrencode's own splitter, byte mode unless it's obviously
+        // cheaper to switch
+        SegmentationGreedy,
+        // The shortest possible sequence of numeric, alphanumeric, byte
+        // and kanji segments, which may result in a smaller version
+        SegmentationOptimal
+    };
+
+    class CancelToken {
+    public:
+        virtual ~CancelToken() {}
+        virtual bool isCanceled() const = 0;
+    };
+
+    // Where the time goes, in nanoseconds. Encoding includes packing.
+    struct Timing {
+        Timing() : iEncode(0), iPack(0) {}
+        qint64 iEncode;
+        qint64 iPack;
+    };
+
+    // UTF-8 conversion and splitting the text into segments don't depend
+    // on the EC level. That's done once here, then each level only takes
+    // care of version selection, ECC and masking. Read-only once it's
+    // constructed, can be encoded by several threads at the same time.
+    class Input {
+        Q_DISABLE_COPY(Input)
+        friend class QrCodeGenerator;
+    public:
+        Input(const QString&, Segmentation aSegmentation = SegmentationGreedy);
+        ~Input();
+        bool isValid() const;
+    private:
+        _QRinput* input(HarbourQrCodeGenerator::ECLevel, int*) const;
+        _QRinput* input(int) const;
+    private:
+        Segmentation iSegmentation;
+        _QRinput* iInput[VersionRanges];
+        int iBits[VersionRanges];
+    };
+
+    // Structured append, i.e. the input split across up to 16 linked
+    // symbols, none of them bigger than the given version. Among the
+    // versions producing the same (smallest) number of symbols, the
+    // smallest one is picked. The count is 1 if the input fits into a
+    // single symbol anyway, and 0 if it doesn't fit even into 16 of
+    // them. The symbols can be encoded by several threads at the same
+    // time.
+    class Sequence {
+        Q_DISABLE_COPY(Sequence)
+        friend class QrCodeGenerator;
+    public:
+        enum { MaxCount = 16 };
+        Sequence(const Input&, HarbourQrCodeGenerator::ECLevel, int aMaxVersion);
+        ~Sequence();
+        int count() const;
+        int version() const;
+    private:
+        _QRinput_Struct* iStruct;
+        QList<_QRinput*> iSymbols;
+        int iVersion;
+    };
+
+    // Analytic capacity check, which doesn't allocate any memory and
+    // takes a fraction of the time needed to actually segment the text.
+    // Each character is assumed to take the cheapest mode it may be
+    // eligible for (any non-ASCII one, the kanji mode) so the estimate
+    // is a lower bound of what the optimal segmentation produces. It
+    // never rules out a level which the text would fit into, but may
+    // let through the one which it doesn't quite fit into after all.
+    class Capacity {
+    public:
+        Capacity(const QString&);
+        int bits(int aVersion) const;
+        // The smallest version which may hold the text, 0 if none
+        int version(HarbourQrCodeGenerator::ECLevel) const;
+        // The smallest number of structured append symbols of the
+        // given version which may hold the text
+        int symbols(HarbourQrCodeGenerator::ECLevel, int aVersion) const;
+    private:
+        int iBits[VersionRanges];
+    };
+
+    static QByteArray generate(const Input&, HarbourQrCodeGenerator::ECLevel,
+        const CancelToken* aCancel = Q_NULLPTR, Timing* aTiming = Q_NULLPTR);
+    static QByteArray generate(const QString&, HarbourQrCodeGenerator::ECLevel,
+        const CancelToken* aCancel = Q_NULLPTR);
+    static QByteArray generate(const QString&, HarbourQrCodeGenerator::ECLevel,
+        Segmentation, const CancelToken* aCancel = Q_NULLPTR);
+    static QByteArray generate(const Sequence&, int,
+        const CancelToken* aCancel = Q_NULLPTR, Timing* aTiming = Q_NULLPTR);
+
+    // Micro QR (M1-M4) for short texts, which fit into a single numeric,
+    // alphanumeric or byte segment. There's no level H, M1 only supports
+    // L (which is actually error detection only). The smallest version
+    // which fits is used, 0 if there's none. microVersion() is exact and
+    // doesn't allocate any memory.
+    static int microVersion(const QString&, HarbourQrCodeGenerator::ECLevel);
+    static QByteArray generateMicro(const QString&, HarbourQrCodeGenerator::ECLevel,
+        const CancelToken* aCancel = Q_NULLPTR, Timing* aTiming = Q_NULLPTR);
+
+    // Opt-in, process-wide. Mask trials for the symbols of this version
+    // and above are run in parallel on the QrCodeScheduler pool, which
+    // only pays off for large symbols. Zero (the default) disables that.
+    // The output is the same either way.
+    static int parallelMaskVersion();
+    static void setParallelMaskVersion(int);
+
+private:
+    static QByteArray encode(_QRinput*, const CancelToken*, Timing*);
+    static int microMode(const QString&, int*);
+    static int microFit(int, int, HarbourQrCodeGenerator::ECLevel);
+    static _QRinput* microInput(const QString&, HarbourQrCodeGenerator::ECLevel, int*);
+
+private:
+    class ArenaScope;
+    class CancelScope;
+    class ParallelScope;
+    class Segmenter;
+};
+
+#endif // QRCODE_GENERATOR_H
@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "QrCodeHistoryModel.h"
+#include "QrCodeArena.h"
+#include "QrCodeImageProvider.h"
+#include "QrCodeModel.h"
+
+#include "HarbourQrCodeGenerator.h"
+#include "HarbourDebug.h"
+
+#include <QtCore/QPointer>
+#include <QtCore/QStringList>
+
+// ==========================================================================
+// QrCodeHistoryModel::Entry
+//
+// The text is stored as UTF-8, the codes as arena handles (zero if the
+// level is not available).
+// ==========================================================================
+
+class QrCodeHistoryModel::Entry
+{
+public:
+    Entry(const QString&, const QByteArray*);
+    ~Entry();
+
+    int defaultLevel() const;
+
+public:
+    const QByteArray iText;
+    quint32 iCode[HarbourQrCodeGenerator::ECLevelCount];
+};
+
+QrCodeHistoryModel::Entry::Entry(
+    const QString& aText,
+    const QByteArray* aBits) :
+    iText(aText.toUtf8())
+{
+    for (int i = 0; i < HarbourQrCodeGenerator::ECLevelCount; i++) {
+        iCode[i] = QrCodeArena::add(aBits[i]);
+    }
+}
+
+QrCodeHistoryModel::Entry::~Entry()
+{
+    for (int i = 0; i < HarbourQrCodeGenerator::ECLevelCount; i++) {
+        if (iCode[i]) QrCodeArena::remove(iCode[i]);
+    }
+}
+
+int
+QrCodeHistoryModel::Entry::defaultLevel() const
+{
+    // Same as QrCodeModel, the lowest available level
+    for (int i = 0; i < HarbourQrCodeGenerator::ECLevelCount; i++) {
+        if (iCode[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// ==========================================================================
+// QrCodeHistoryModel::Private
+// ==========================================================================
+
+class QrCodeHistoryModel::Private :
+    public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Role {
+        TextRole = Qt::UserRole,
+        QrCodeRole,
+        QrCodesRole,
+        EcLevelRole,
+        ModulesRole
+    };
+
+    Private(QrCodeHistoryModel*);
+    ~Private();
+
+    QrCodeHistoryModel* parentModel() const;
+    int find(const QByteArray&) const;
+    void trim();
+
+public Q_SLOTS:
+    void onGenerated();
+
+public:
+    QPointer<QrCodeModel> iSource;
+    QList<Entry*> iEntries;
+    int iMaxCount;
+};
+
+QrCodeHistoryModel::Private::Private(
+    QrCodeHistoryModel* aParent) :
+    QObject(aParent),
+    iMaxCount(DefaultMaxCount)
+{
+}
+
+QrCodeHistoryModel::Private::~Private()
+{
+    qDeleteAll(iEntries);
+}
+
+inline
+QrCodeHistoryModel*
+QrCodeHistoryModel::Private::parentModel() const
+{
+    return qobject_cast<QrCodeHistoryModel*>(parent());
+}
+
+int
+QrCodeHistoryModel::Private::find(
+    const QByteArray& aText) const
+{
+    for (int i = 0; i < iEntries.count(); i++) {
+        if (iEntries.at(i)->iText == aText) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void
+QrCodeHistoryModel::Private::trim()
+{
+    const int n = iEntries.count();
+    if (n > iMaxCount) {
+        QrCodeHistoryModel* model = parentModel();
+        model->beginRemoveRows(QModelIndex(), iMaxCount, n - 1);
+        while (iEntries.count() > iMaxCount) {
+            delete iEntries.takeLast();
+        }
+        model->endRemoveRows();
+        Q_EMIT model->countChanged();
+    }
+}
+
+void
+QrCodeHistoryModel::Private::onGenerated()
+{
+    const QString text(iSource ? iSource->getText() : QString());
+    if (!text.isEmpty()) {
+        QrCodeHistoryModel* model = parentModel();
+        const QByteArray utf8(text.toUtf8());
+        const int pos = find(utf8);
+
+        if (pos > 0) {
+            // Seen it before, just move it to the top
+            HDEBUG("Moving" << pos << "to the top");
+            model->beginMoveRows(QModelIndex(), pos, pos, QModelIndex(), 0);
+            iEntries.move(pos, 0);
+            model->endMoveRows();
+        } else if (pos < 0) {
+            QByteArray bits[HarbourQrCodeGenerator::ECLevelCount];
+            bool empty = true;
+
+            for (int i = 0; i < HarbourQrCodeGenerator::ECLevelCount; i++) {
+                bits[i] = iSource->codeBits(i);
+                if (!bits[i].isEmpty()) {
+                    empty = false;
+                }
+            }
+            if (!empty) {
+                HDEBUG("Adding" << text);
+                model->beginInsertRows(QModelIndex(), 0, 0);
+                iEntries.insert(0, new Entry(text, bits));
+                model->endInsertRows();
+                Q_EMIT model->countChanged();
+                trim();
+            }
+        }
+    }
+}
+
+// ==========================================================================
+// QrCodeHistoryModel
+// ==========================================================================
+
+QrCodeHistoryModel::QrCodeHistoryModel(
+    QObject* aParent) :
+    QAbstractListModel(aParent),
+    iPrivate(new Private(this))
+{
+}
+
+QrCodeHistoryModel::~QrCodeHistoryModel()
+{
+    delete iPrivate;
+}
+
+QrCodeModel*
+QrCodeHistoryModel::getSource() const
+{
+    return iPrivate->iSource;
+}
+
+void
+QrCodeHistoryModel::setSource(
+    QrCodeModel* aSource)
+{
+    if (iPrivate->iSource != aSource) {
+        if (iPrivate->iSource) {
+            iPrivate->iSource->disconnect(iPrivate);
+        }
+        iPrivate->iSource = aSource;
+        if (aSource) {
+            connect(aSource, SIGNAL(generated()),
+                iPrivate, SLOT(onGenerated()));
+        }
+        Q_EMIT sourceChanged();
+    }
+}
+
+int
+QrCodeHistoryModel::getMaxCount() const
+{
+    return iPrivate->iMaxCount;
+}
+
+void
+QrCodeHistoryModel::setMaxCount(
+    int aCount)
+{
+    const int count = qMax(aCount, 0);
+    if (iPrivate->iMaxCount != count) {
+        iPrivate->iMaxCount = count;
+        HDEBUG(count);
+        iPrivate->trim();
+        Q_EMIT maxCountChanged();
+    }
+}
+
+int
+QrCodeHistoryModel::getCount() const
+{
+    return iPrivate->iEntries.count();
+}
+
+void
+QrCodeHistoryModel::remove(
+    int aRow)
+{
+    if (aRow >= 0 && aRow < iPrivate->iEntries.count()) {
+        beginRemoveRows(QModelIndex(), aRow, aRow);
+        delete iPrivate->iEntries.takeAt(aRow);
+        endRemoveRows();
+        Q_EMIT countChanged();
+    }
+}
+
+void
+QrCodeHistoryModel::clear()
+{
+    if (!iPrivate->iEntries.isEmpty()) {
+        beginResetModel();
+        qDeleteAll(iPrivate->iEntries);
+        iPrivate->iEntries.clear();
+        endResetModel();
+        Q_EMIT countChanged();
+    }
+}
+
+QHash<int,QByteArray>
+QrCodeHistoryModel::roleNames() const
+{
+    QHash<int,QByteArray> roles;
+    roles.insert(Private::TextRole, "text");
+    roles.insert(Private::QrCodeRole, "qrcode");
+    roles.insert(Private::QrCodesRole, "qrcodes");
+    roles.insert(Private::EcLevelRole, "eclevel");
+    roles.insert(Private::ModulesRole, "modules");
+    return roles;
+}
+
+int
+QrCodeHistoryModel::rowCount(
+    const QModelIndex&) const
+{
+    return iPrivate->iEntries.count();
+}
+
+QVariant
+QrCodeHistoryModel::data(
+    const QModelIndex& aIndex,
+    int aRole) const
+{
+    const int row = aIndex.row();
+    if (row >= 0 && row < iPrivate->iEntries.count()) {
+        const Entry* entry = iPrivate->iEntries.at(row);
+        const int level = entry->defaultLevel();
+        switch ((Private::Role)aRole) {
+        case Private::TextRole:
+            return QString::fromUtf8(entry->iText);
+        case Private::QrCodeRole:
+            return QrCodeArena::id(level >= 0 ? entry->iCode[level] : 0);
+        case Private::QrCodesRole: {
+                // One per level, empty if not available
+                QStringList ids;
+                for (int i = 0; i < HarbourQrCodeGenerator::ECLevelCount; i++) {
+                    ids.append(QrCodeArena::id(entry->iCode[i]));
+                }
+                return ids;
+            }
+        case Private::EcLevelRole:
+            return level;
+        case Private::ModulesRole:
+            return (level >= 0) ? QrCodeImageProvider::moduleCount(
+                QrCodeArena::bits(entry->iCode[level])) : 0;
+        }
+    }
+    return QVariant();
+}
+
+#include "QrCodeHistoryModel.moc"
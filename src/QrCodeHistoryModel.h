@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#ifndef QRCODE_HISTORY_MODEL_H
+#define QRCODE_HISTORY_MODEL_H
+
+#include <QtCore/QAbstractListModel>
+
+class QrCodeModel;
+
+// The last maxCount texts seen by the source model, most recent first,
+// with the codes generated for them. The codes are kept in QrCodeArena,
+// the images are rendered on demand by the image provider.
+class QrCodeHistoryModel :
+    public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QrCodeModel* source READ getSource WRITE setSource NOTIFY sourceChanged)
+    Q_PROPERTY(int maxCount READ getMaxCount WRITE setMaxCount NOTIFY maxCountChanged)
+    Q_PROPERTY(int count READ getCount NOTIFY countChanged)
+
+public:
+    static const int DefaultMaxCount = 100;
+
+    QrCodeHistoryModel(QObject* aParent = Q_NULLPTR);
+    ~QrCodeHistoryModel();
+
+    QrCodeModel* getSource() const;
+    void setSource(QrCodeModel*);
+    int getMaxCount() const;
+    void setMaxCount(int);
+    int getCount() const;
+
+    Q_INVOKABLE void remove(int);
+    Q_INVOKABLE void clear();
+
+    // QAbstractItemModel
+    QHash<int,QByteArray> roleNames() const Q_DECL_OVERRIDE;
+    int rowCount(const QModelIndex&) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex&, int) const Q_DECL_OVERRIDE;
+
+Q_SIGNALS:
+    void sourceChanged();
+    void maxCountChanged();
+    void countChanged();
+
+private:
+    class Entry;
+    class Private;
+    Private* iPrivate;
+};
+
+#endif // QRCODE_HISTORY_MODEL_H
@@ -0,0 +1,361 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "QrCodeImageProvider.h"
+#include "QrCodeRegistry.h"
+
+#include "HarbourDebug.h"
+
+#include <QtCore/QCache>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QStringList>
+
+// ==========================================================================
+// QrCodeImageProvider::Key
+// ==========================================================================
+
+class QrCodeImageProvider::Key
+{
+public:
+    Key(const QString&, QRgb, int, const QSize&);
+
+    bool operator==(const Key&) const;
+    friend uint qHash(const Key& aKey, uint aSeed) { return aKey.iHash ^ aSeed; }
+
+public:
+    QString iCode;
+    QRgb iColor;
+    int iMargin;
+    QSize iSize;
+    uint iHash;
+};
+
+QrCodeImageProvider::Key::Key(
+    const QString& aCode,
+    QRgb aColor,
+    int aMargin,
+    const QSize& aSize) :
+    iCode(aCode),
+    iColor(aColor),
+    iMargin(aMargin),
+    iSize(aSize),
+    iHash(qHash(aCode) ^ aColor ^ (aMargin << 24) ^
+        (aSize.width() << 12) ^ aSize.height())
+{
+}
+
+inline
+bool
+QrCodeImageProvider::Key::operator==(
+    const Key& aKey) const
+{
+    return iHash == aKey.iHash && iColor == aKey.iColor &&
+        iMargin == aKey.iMargin && iSize == aKey.iSize &&
+        iCode == aKey.iCode;
+}
+
+// ==========================================================================
+// QrCodeImageProvider::Private
+// ==========================================================================
+
+class QrCodeImageProvider::Private
+{
+public:
+    Private(int);
+
+    bool find(const Key&, QImage*);
+    void insert(const Key&, const QImage&);
+
+public:
+    QMutex iMutex;
+    QCache<Key,QImage> iCache;
+    uint iHits;
+    uint iMisses;
+};
+
+QrCodeImageProvider::Private::Private(
+    int aCapacity) :
+    iCache(qMax(aCapacity, 0)),
+    iHits(0),
+    iMisses(0)
+{
+}
+
+bool
+QrCodeImageProvider::Private::find(
+    const Key& aKey,
+    QImage* aImage)
+{
+    QMutexLocker lock(&iMutex);
+    const QImage* img = iCache.object(aKey);
+
+    if (img) {
+        iHits++;
+        // Implicitly shared, the pixels aren't copied
+        *aImage = *img;
+        return true;
+    } else {
+        iMisses++;
+        return false;
+    }
+}
+
+void
+QrCodeImageProvider::Private::insert(
+    const Key& aKey,
+    const QImage& aImage)
+{
+    const int cost = sizeof(Key) + sizeof(QImage) + aImage.byteCount() +
+        aKey.iCode.size() * sizeof(QChar);
+    QMutexLocker lock(&iMutex);
+
+    iCache.insert(aKey, new QImage(aImage), cost);
+}
+
+// ==========================================================================
+// QrCodeImageProvider
+// ==========================================================================
+
+QrCodeImageProvider::QrCodeImageProvider(
+    int aCacheCapacity) :
+    QQuickImageProvider(Image),
+    iPrivate(new Private(aCacheCapacity))
+{
+}
+
+QrCodeImageProvider::~QrCodeImageProvider()
+{
+    delete iPrivate;
+}
+
+int
+QrCodeImageProvider::cacheCapacity() const
+{
+    QMutexLocker lock(&iPrivate->iMutex);
+    return iPrivate->iCache.maxCost();
+}
+
+void
+QrCodeImageProvider::setCacheCapacity(
+    int aCapacity)
+{
+    QMutexLocker lock(&iPrivate->iMutex);
+    iPrivate->iCache.setMaxCost(qMax(aCapacity, 0));
+}
+
+int
+QrCodeImageProvider::cacheSize() const
+{
+    QMutexLocker lock(&iPrivate->iMutex);
+    return iPrivate->iCache.totalCost();
+}
+
+uint
+QrCodeImageProvider::cacheHits() const
+{
+    QMutexLocker lock(&iPrivate->iMutex);
+    return iPrivate->iHits;
+}
+
+uint
+QrCodeImageProvider::cacheMisses() const
+{
+    QMutexLocker lock(&iPrivate->iMutex);
+    return iPrivate->iMisses;
+}
+
+int
+QrCodeImageProvider::moduleCount(
+    const QByteArray& aBits)
+{
+    // Each row is padded to the byte boundary, the code is square
+    const int bytes = aBits.size();
+    int n = 1;
+    while (((n + 7) / 8) * n < bytes) n++;
+    return (((n + 7) / 8) * n == bytes) ? n : 0;
+}
+
+int
+QrCodeImageProvider::scaleToFit(
+    int aModules,
+    int aMargin,
+    const QSize& aSize)
+{
+    // Zero (or negative) dimension means "don't care"
+    const int w = aSize.width();
+    const int h = aSize.height();
+    const int avail = (w > 0 && h > 0) ? qMin(w, h) : qMax(w, h);
+    const int total = aModules + 2 * aMargin;
+    return (avail > 0 && total > 0) ? qMax(avail / total, 1) : 1;
+}
+
+static
+inline
+void
+qrcode_image_fill_bits(
+    uchar* aLine,
+    int aStart,
+    int aCount)
+{
+    // Sets aCount bits starting at aStart, MSB first
+    while (aCount > 0) {
+        const int bit = aStart % 8;
+        const int len = qMin(8 - bit, aCount);
+        aLine[aStart / 8] |= (uchar)((0xff >> bit) & (0xff << (8 - bit - len)));
+        aStart += len;
+        aCount -= len;
+    }
+}
+
+QImage
+QrCodeImageProvider::createImage(
+    const QByteArray& aBits,
+    const QColor& aColor,
+    int aScale,
+    int aMargin)
+{
+    const int n = moduleCount(aBits);
+    if (n > 0 && aScale > 0 && aMargin >= 0) {
+        // Packed rows are laid out exactly like QImage::Format_Mono rows
+        const int bytesPerRow = (n + 7) / 8;
+        const int size = (n + 2 * aMargin) * aScale;
+        const uchar* src = (const uchar*)aBits.constData();
+        QImage img(size, size, QImage::Format_Mono);
+
+        img.setColorCount(2);
+        img.setColor(0, qRgba(0, 0, 0, 0));
+        img.setColor(1, aColor.rgba());
+        if (aScale == 1 && !aMargin) {
+            for (int y = 0; y < n; y++, src += bytesPerRow) {
+                memcpy(img.scanLine(y), src, bytesPerRow);
+            }
+        } else {
+            // Each row of modules is expanded once, the remaining
+            // scanlines of the same row are copies of the first one
+            const int bpl = img.bytesPerLine();
+            const int offset = aMargin * aScale;
+            uchar* line = img.bits() + offset * bpl;
+
+            img.fill(0);
+            for (int y = 0; y < n; y++, src += bytesPerRow) {
+                for (int x = 0; x < n;) {
+                    if (src[x / 8] & (0x80 >> (x % 8))) {
+                        // Dark modules are filled a run at a time
+                        const int start = x;
+                        do { x++; } while (x < n && (src[x / 8] & (0x80 >> (x % 8))));
+                        qrcode_image_fill_bits(line, offset + start * aScale,
+                            (x - start) * aScale);
+                    } else {
+                        x++;
+                    }
+                }
+                const uchar* first = line;
+                line += bpl;
+                for (int k = 1; k < aScale; k++, line += bpl) {
+                    memcpy(line, first, bpl);
+                }
+            }
+        }
+        return img;
+    }
+    return QImage();
+}
+
+QImage
+QrCodeImageProvider::requestImage(
+    const QString& aId,
+    QSize* aSize,
+    const QSize& aRequestedSize)
+{
+    // Parse the parameters
+    QColor color(Qt::black);
+    int margin = 0;
+    const int sep = aId.indexOf('?');
+    if (sep >= 0) {
+        // Don't use QUrlQuery, the color may start with #
+        const QStringList params(aId.mid(sep + 1).split('&', QString::SkipEmptyParts));
+        const int n = params.count();
+        for (int i = 0; i < n; i++) {
+            const QString param(params.at(i));
+            const int eq = param.indexOf('=');
+            if (eq > 0) {
+                const QString name(param.left(eq));
+                const QString value(param.mid(eq + 1));
+                if (name == QLatin1String("color")) {
+                    const QColor c(value);
+                    if (c.isValid()) {
+                        color = c;
+                    } else {
+                        HWARN("Invalid color" << value);
+                    }
+                } else if (name == QLatin1String("margin")) {
+                    bool ok;
+                    const int m = value.toInt(&ok);
+                    if (ok && m >= 0) {
+                        margin = m;
+                    } else {
+                        HWARN("Invalid margin" << value);
+                    }
+                }
+            }
+        }
+    }
+
+    // The code (registry id or the bits themselves) identifies the
+    // matrix, the requested size determines the scale
+    const QString code(sep >= 0 ? aId.left(sep) : aId);
+    const Key key(code, color.rgba(), margin, aRequestedSize);
+    QImage img;
+
+    if (iPrivate->find(key, &img)) {
+        HDEBUG(code << aRequestedSize << img.size() << "(cached)");
+    } else {
+        const QByteArray bits(QrCodeRegistry::find(code));
+        const int scale = scaleToFit(moduleCount(bits), margin, aRequestedSize);
+        img = createImage(bits, color, scale, margin);
+        HDEBUG(code << aRequestedSize << img.size());
+        if (!img.isNull()) {
+            iPrivate->insert(key, img);
+        }
+    }
+    if (aSize) {
+        *aSize = img.size();
+    }
+    return img;
+}
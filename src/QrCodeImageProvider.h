@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#ifndef QRCODE_IMAGE_PROVIDER_H
+#define QRCODE_IMAGE_PROVIDER_H
+
+#include <QtGui/QColor>
+#include <QtQuick/QQuickImageProvider>
+
+// Handles image://qrcode/<code>[?color=<color>][&margin=<modules>]
+// where <code> is either a QrCodeRegistry id or base32 encoded bits.
+// If the size is requested, the code is rendered at the largest whole
+// number of pixels per module that fits, otherwise at one pixel per
+// module. The margin (quiet zone) is transparent, there's none by
+// default. Rendered images are cached, so that repeated requests
+// (e.g. after orientation changes) are served without rendering.
+class QrCodeImageProvider :
+    public QQuickImageProvider
+{
+public:
+    static const int DefaultCacheCapacity = 0x400000; // bytes
+
+    QrCodeImageProvider(int aCacheCapacity = DefaultCacheCapacity);
+    ~QrCodeImageProvider();
+
+    static int moduleCount(const QByteArray&);
+    static int scaleToFit(int, int, const QSize&);
+    static QImage createImage(const QByteArray&, const QColor& aColor = QColor(Qt::black),
+        int aScale = 1, int aMargin = 0);
+
+    int cacheCapacity() const;
+    void setCacheCapacity(int);
+    int cacheSize() const;
+    uint cacheHits() const;
+    uint cacheMisses() const;
+
+    QImage requestImage(const QString&, QSize*, const QSize&) Q_DECL_OVERRIDE;
+
+private:
+    class Key;
+    class Private;
+    Private* iPrivate;
+};
+
+#endif // QRCODE_IMAGE_PROVIDER_H
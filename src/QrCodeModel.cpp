@@ -38,45 +38,328 @@
  */
 
 #include "QrCodeModel.h"
+#include "QrCodeCache.h"
+#include "QrCodeGenerator.h"
+#include "QrCodeImageProvider.h"
+#include "QrCodeRegistry.h"
+#include "QrCodeScheduler.h"
+#include "QrCodeTrace.h"
 
-#include "HarbourQrCodeGenerator.h"
-#include "HarbourBase32.h"
 #include "HarbourTask.h"
 #include "HarbourDebug.h"
 
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QStringList>
+
+// Regular codes are indexed by EC level, Micro QR codes (levels L, M
+// and Q) occupy the slots following them
+enum QrCodeModelSlot {
+    QrCodeModelMicroSlot = HarbourQrCodeGenerator::ECLevelCount,
+    QrCodeModelSlotCount = QrCodeModelMicroSlot + HarbourQrCodeGenerator::ECLevel_Q + 1
+};
+
+// Regular rows come first, so that the default code is always readable
+// by any scanner. Micro QR rows (not supported by all of them) follow.
+static const int qrCodeModelRowOrder[QrCodeModelSlotCount] = {
+    HarbourQrCodeGenerator::ECLevel_L,
+    HarbourQrCodeGenerator::ECLevel_M,
+    HarbourQrCodeGenerator::ECLevel_Q,
+    HarbourQrCodeGenerator::ECLevel_H,
+    QrCodeModelMicroSlot + HarbourQrCodeGenerator::ECLevel_L,
+    QrCodeModelMicroSlot + HarbourQrCodeGenerator::ECLevel_M,
+    QrCodeModelMicroSlot + HarbourQrCodeGenerator::ECLevel_Q
+};
+
 // ==========================================================================
 // QrCodeModel::Task
 // ==========================================================================
 
 class QrCodeModel::Task :
-    public HarbourTask
+    public HarbourTask,
+    public QrCodeGenerator::CancelToken
 {
     Q_OBJECT
 
 public:
-    Task(QThreadPool*, const QString&);
+    Task(QThreadPool*, const QString&, uint, int, bool,
+        QrCodeScheduler::Priority);
     void performTask() Q_DECL_OVERRIDE;
+    bool isCanceled() const Q_DECL_OVERRIDE;
+
+private:
+    class LevelJob;
+    class SymbolJob;
+
+    static QByteArray generateSymbol(const QrCodeGenerator::Sequence*, int,
+        const Task*, QrCodeGenerator::Timing*);
+    void generateSequence(int, const QrCodeGenerator::Sequence&);
+    void generate(int);
+    uint impossibleLevels() const;
+
+Q_SIGNALS:
+    void levelDone(int, QByteArray);
+    void sequenceDone(int, QByteArrayList);
 
 public:
     QString iText;
-    QString iCode[HarbourQrCodeGenerator::ECLevelCount];
+    uint iLevels;
+    int iMaxVersion;
+    bool iOptimalSegmentation;
+    QrCodeScheduler::Priority iPriority;
+    const QrCodeGenerator::Input* iInput;
+
+    // Nanoseconds since the text change, each level is written by the
+    // thread generating it before it's published
+    QElapsedTimer iClock;
+    qint64 iStarted;
+    qint64 iLevelStart[QrCodeModelSlotCount];
+    QrCodeGenerator::Timing iTiming[QrCodeModelSlotCount];
 };
 
 QrCodeModel::Task::Task(
     QThreadPool* aPool,
-    const QString& aText) :
+    const QString& aText,
+    uint aLevels,
+    int aMaxVersion,
+    bool aOptimalSegmentation,
+    QrCodeScheduler::Priority aPriority) :
     HarbourTask(aPool),
-    iText(aText)
+    iText(aText),
+    iLevels(aLevels),
+    iMaxVersion(aMaxVersion),
+    iOptimalSegmentation(aOptimalSegmentation),
+    iPriority(aPriority),
+    iInput(Q_NULLPTR),
+    iStarted(0)
+{
+    for (int i = 0; i < QrCodeModelSlotCount; i++) {
+        iLevelStart[i] = 0;
+    }
+}
+
+bool
+QrCodeModel::Task::isCanceled() const
+{
+    // Released tasks are cancelled
+    return HarbourTask::isCanceled();
+}
+
+// Level (or symbol) jobs are queued with the priority of the task
+// which has submitted them
+
+class QrCodeModel::Task::LevelJob :
+    public QrCodeScheduler::Job
+{
+public:
+    LevelJob(Task* aTask, int aLevel) : iTask(aTask), iLevel(aLevel) {}
+    void perform() Q_DECL_OVERRIDE { iTask->generate(iLevel); }
+
+private:
+    Task* iTask;
+    const int iLevel;
+};
+
+class QrCodeModel::Task::SymbolJob :
+    public QrCodeScheduler::Job
+{
+public:
+    SymbolJob(const Task* aTask, const QrCodeGenerator::Sequence* aSequence,
+        int aIndex, QrCodeGenerator::Timing* aTiming) : iTask(aTask),
+        iSequence(aSequence), iIndex(aIndex), iTiming(aTiming) {}
+    void perform() Q_DECL_OVERRIDE
+        { iBits = generateSymbol(iSequence, iIndex, iTask, iTiming); }
+
+public:
+    const Task* iTask;
+    const QrCodeGenerator::Sequence* iSequence;
+    const int iIndex;
+    QrCodeGenerator::Timing* iTiming;
+    QByteArray iBits;
+};
+
+QByteArray
+QrCodeModel::Task::generateSymbol(
+    const QrCodeGenerator::Sequence* aSequence,
+    int aIndex,
+    const Task* aTask,
+    QrCodeGenerator::Timing* aTiming)
+{
+    return aTask->isCanceled() ? QByteArray() :
+        QrCodeGenerator::generate(*aSequence, aIndex, aTask, aTiming);
+}
+
+void
+QrCodeModel::Task::generateSequence(
+    int aLevel,
+    const QrCodeGenerator::Sequence& aSequence)
+{
+    // Symbols don't depend on each other either. The first one is
+    // encoded on this thread, the rest are handed over to the pool.
+    const int n = aSequence.count();
+    SymbolJob* symbol[QrCodeGenerator::Sequence::MaxCount];
+    QrCodeGenerator::Timing timing[QrCodeGenerator::Sequence::MaxCount];
+    QrCodeGenerator::Timing* total = iTiming + aLevel;
+    QByteArrayList bits;
+
+    HDEBUG("Level" << aLevel << "split into" << n << "symbols, version" <<
+        aSequence.version());
+    for (int i = 1; i < n; i++) {
+        symbol[i] = new SymbolJob(this, &aSequence, i, timing + i);
+        symbol[i]->start(iPriority);
+    }
+    bits.append(generateSymbol(&aSequence, 0, this, timing));
+    for (int i = 1; i < n; i++) {
+        // Runs the job on this thread if it hasn't started yet
+        symbol[i]->wait();
+        bits.append(symbol[i]->iBits);
+        symbol[i]->release();
+    }
+
+    // Encoding is the wall time, packing is the total CPU time
+    total->iEncode = iClock.nsecsElapsed() - iLevelStart[aLevel];
+    for (int i = 0; i < n; i++) {
+        total->iPack += timing[i].iPack;
+    }
+    if (!isCanceled()) {
+        // It's all or nothing
+        if (bits.contains(QByteArray())) {
+            bits.clear();
+        }
+        Q_EMIT sequenceDone(aLevel, bits);
+    }
+}
+
+void
+QrCodeModel::Task::generate(
+    int aLevel)
 {
+    iLevelStart[aLevel] = iClock.nsecsElapsed();
+    if (aLevel >= QrCodeModelMicroSlot) {
+        // Micro QR, no structured append and no shared input
+        const QByteArray bits(isCanceled() ? QByteArray() :
+            QrCodeGenerator::generateMicro(iText, (HarbourQrCodeGenerator::ECLevel)
+                (aLevel - QrCodeModelMicroSlot), this, iTiming + aLevel));
+        if (!isCanceled()) {
+            Q_EMIT levelDone(aLevel, bits);
+        }
+        return;
+    }
+    if (!isCanceled() && iMaxVersion > 0) {
+        // Structured append kicks in if the text doesn't fit into
+        // a single symbol of the maximum version
+        const QrCodeGenerator::Sequence sequence(*iInput,
+            (HarbourQrCodeGenerator::ECLevel)aLevel, iMaxVersion);
+        if (sequence.count() > 1) {
+            generateSequence(aLevel, sequence);
+            return;
+        }
+    }
+    if (!isCanceled()) {
+        // The encoder gives up as soon as it notices that this task
+        // has been cancelled, and the empty result is dropped here
+        const QByteArray bits(QrCodeGenerator::generate(*iInput,
+            (HarbourQrCodeGenerator::ECLevel)aLevel, this, iTiming + aLevel));
+        if (!isCanceled()) {
+            // Queued to the thread which owns the model
+            Q_EMIT levelDone(aLevel, bits);
+        }
+    }
+}
+
+uint
+QrCodeModel::Task::impossibleLevels() const
+{
+    // Single pass over the text, no memory allocation, no encoding
+    const QrCodeGenerator::Capacity capacity(iText);
+    uint impossible = 0;
+
+    for (int i = 0; i < HarbourQrCodeGenerator::ECLevelCount; i++) {
+        const HarbourQrCodeGenerator::ECLevel level =
+            (HarbourQrCodeGenerator::ECLevel)i;
+
+        // Structured append is only used if a single symbol won't do
+        if ((iLevels & (1u << i)) && !capacity.version(level) &&
+            (iMaxVersion <= 0 || capacity.symbols(level, iMaxVersion) >
+            QrCodeGenerator::Sequence::MaxCount)) {
+            impossible |= (1u << i);
+        }
+    }
+    for (int i = QrCodeModelMicroSlot; i < QrCodeModelSlotCount; i++) {
+        if ((iLevels & (1u << i)) && !QrCodeGenerator::microVersion(iText,
+            (HarbourQrCodeGenerator::ECLevel)(i - QrCodeModelMicroSlot))) {
+            impossible |= (1u << i);
+        }
+    }
+    return impossible;
 }
 
 void
 QrCodeModel::Task::performTask()
 {
-    for (int i = 0; i < HarbourQrCodeGenerator::ECLevelCount && !isCanceled(); i++) {
-        iCode[i] = HarbourBase32::toBase32(HarbourQrCodeGenerator::generate(iText,
-            (HarbourQrCodeGenerator::ECLevel)i));
+    iStarted = iClock.nsecsElapsed();
+
+    // Tasks are serialized. If the text has changed again while this
+    // one was waiting in the queue, there's nothing to do. That way
+    // rapid changes get coalesced and only the last text is encoded.
+    if (isCanceled()) {
+        HDEBUG("Skipping" << iText);
+        return;
+    }
+
+    // Levels which the text definitely doesn't fit into are reported
+    // right away (as empty), there's no point in trying to encode those.
+    // The check is a single pass over the text but that's still too
+    // much for the main thread if the text is long.
+    const uint impossible = impossibleLevels();
+    for (int i = 0; i < QrCodeModelSlotCount; i++) {
+        if (impossible & (1u << i)) {
+            HDEBUG("Level" << i << "can't fit the text");
+            iLevelStart[i] = iClock.nsecsElapsed();
+            Q_EMIT levelDone(i, QByteArray());
+        }
+    }
+    iLevels &= ~impossible;
+
+    // Everything this task hands over to the pool (including the mask
+    // trials, if they are run in parallel) inherits its priority
+    QrCodeScheduler::PriorityScope priority(iPriority);
+
+    // The text is analyzed once, the results are shared by all levels.
+    // It stays around until all the levels are done, see below.
+    const QrCodeGenerator::Input input(iText, iOptimalSegmentation ?
+        QrCodeGenerator::SegmentationOptimal :
+        QrCodeGenerator::SegmentationGreedy);
+    iInput = &input;
+
+    // Levels are independent from each other. The first one (in the
+    // row order) is the one which becomes the default code, so it's
+    // started first and on this thread. The rest are handed over to the
+    // scheduler's pool, queued with the priority of this task.
+    int first = -1;
+    LevelJob* level[QrCodeModelSlotCount];
+    for (int r = 0; r < QrCodeModelSlotCount; r++) {
+        const int i = qrCodeModelRowOrder[r];
+        level[i] = Q_NULLPTR;
+        if (iLevels & (1u << i)) {
+            if (first < 0) {
+                first = i;
+            } else {
+                level[i] = new LevelJob(this, i);
+                level[i]->start(iPriority);
+            }
+        }
+    }
+    if (first >= 0) {
+        generate(first);
     }
+    for (int i = 0; i < QrCodeModelSlotCount; i++) {
+        // If the job hasn't started yet, it gets run on this thread
+        if (level[i]) {
+            level[i]->wait();
+            level[i]->release();
+        }
+    }
+    iInput = Q_NULLPTR;
 }
 
 // ==========================================================================
@@ -91,7 +374,31 @@ class QrCodeModel::Private :
 public:
     enum Role {
         QrCodeRole = Qt::UserRole,
-        EcLevelRole
+        EcLevelRole,
+        PendingRole,
+        SequenceRole,
+        ModulesRole,
+        MicroRole
+    };
+
+    typedef QList<QrCodeRegistry::Ref> Sequence;
+
+    // Where the time went last time the text has changed. Nanoseconds
+    // since the text change, negative if it didn't happen.
+    class Latency {
+    public:
+        Latency() { clear(); }
+        void clear();
+        QVariantMap toVariantMap() const;
+        void trace(qint64, int) const;
+    public:
+        qint64 iQueued;
+        qint64 iStarted;
+        qint64 iDone;
+        qint64 iLevelStart[QrCodeModelSlotCount];
+        qint64 iEncode[QrCodeModelSlotCount];
+        qint64 iPack[QrCodeModelSlotCount];
+        qint64 iPublished[QrCodeModelSlotCount];
     };
 
     Private(QrCodeModel*);
@@ -99,34 +406,157 @@ public:
 
     QrCodeModel* parentModel() const;
     int count() const;
+    int rowOf(int) const;
+    bool isPending(int) const;
     QString defaultCode() const;
-    const QString* codeAt(int, HarbourQrCodeGenerator::ECLevel* aLevel = Q_NULLPTR) const;
+    const QrCodeRegistry::Ref* codeAt(int, int* aSlot = Q_NULLPTR) const;
+    QStringList sequenceAt(int) const;
+    static bool sameBits(const Sequence&, const Sequence&);
+    void setCode(int, const QrCodeRegistry::Ref&, const Sequence& aSequence = Sequence());
+    void setPending(uint);
+    void setTooLarge(uint);
     void setText(const QString&);
+    void generate();
+    void setStructuredAppend(bool);
+    void setMaxVersion(int);
+    void setMicroQr(bool);
+    void setOptimalSegmentation(bool);
+    void setPriority(Priority);
+    void setCacheCapacity(int);
+    void restoreSnapshot();
+    void updateCacheStats();
+    void levelPublished(int);
+    void latencyDone();
 
 public Q_SLOTS:
+    void onLevelDone(int, QByteArray);
+    void onSequenceDone(int, QByteArrayList);
     void onTaskDone();
 
 public:
-    QThreadPool* iThreadPool;
+    QrCodeScheduler::Strand* iStrand;
+    Priority iPriority;
     Task* iTask;
     QString iText;
-    QString iCode[HarbourQrCodeGenerator::ECLevelCount];
+    QrCodeRegistry::Ref iCode[QrCodeModelSlotCount];
+    Sequence iSequence[QrCodeModelSlotCount];
+    uint iPending;
+    uint iTooLarge;
+    bool iStructuredAppend;
+    int iMaxVersion;
+    bool iMicroQr;
+    bool iOptimalSegmentation;
+    bool iComplete;
+    QrCodeSnapshot iSnapshot;
+    QElapsedTimer iClock;
+    qint64 iTraceStart;
+    Latency iLatency;
+    QrCodeCache iCache;
+    int iCacheSize;
+    uint iCacheHits;
+    uint iCacheMisses;
+    uint iCacheEvictions;
 };
 
+void
+QrCodeModel::Private::Latency::clear()
+{
+    iQueued = iStarted = iDone = -1;
+    for (int i = 0; i < QrCodeModelSlotCount; i++) {
+        iLevelStart[i] = iEncode[i] = iPack[i] = iPublished[i] = -1;
+    }
+}
+
+QVariantMap
+QrCodeModel::Private::Latency::toVariantMap() const
+{
+    // Milliseconds are easier to deal with in QML
+    static const double ms = 1000000.0;
+    QVariantMap map;
+    QVariantList levels;
+
+    if (iQueued >= 0) map.insert("queued", iQueued / ms);
+    if (iStarted >= 0) map.insert("started", iStarted / ms);
+    if (iDone >= 0) map.insert("done", iDone / ms);
+    for (int i = 0; i < QrCodeModelSlotCount; i++) {
+        if (iPublished[i] >= 0) {
+            const bool micro = (i >= QrCodeModelMicroSlot);
+            QVariantMap level;
+            level.insert("eclevel", micro ? (i - QrCodeModelMicroSlot) : i);
+            level.insert("micro", micro);
+            level.insert("cached", iEncode[i] < 0);
+            if (iEncode[i] >= 0) {
+                level.insert("started", iLevelStart[i] / ms);
+                level.insert("encode", iEncode[i] / ms);
+                level.insert("pack", iPack[i] / ms);
+            }
+            level.insert("published", iPublished[i] / ms);
+            levels.append(level);
+        }
+    }
+    map.insert("levels", levels);
+    return map;
+}
+
+void
+QrCodeModel::Private::Latency::trace(
+    qint64 aOrigin,
+    int aLength) const
+{
+    // Thread 0 is the model, 1 is the task and the levels follow
+    static const char* levelName[] = { "L", "M", "Q", "H", "mL", "mM", "mQ" };
+
+    QrCodeTrace::complete("text " + QByteArray::number(aLength),
+        aOrigin, iDone);
+    if (iQueued >= 0 && iStarted >= 0) {
+        QrCodeTrace::complete("queued", aOrigin + iQueued,
+            iStarted - iQueued, 1);
+    }
+    for (int i = 0; i < QrCodeModelSlotCount; i++) {
+        const QByteArray name(levelName[i]);
+        if (iEncode[i] >= 0) {
+            // Packing of a sequence is the total for all symbols
+            const qint64 end = aOrigin + iLevelStart[i] + iEncode[i];
+            const qint64 pack = qMin(iPack[i], iEncode[i]);
+            QrCodeTrace::complete("encode " + name, aOrigin + iLevelStart[i],
+                iEncode[i], 2 + i);
+            QrCodeTrace::complete("pack " + name, end - pack, pack, 2 + i);
+        }
+        if (iPublished[i] >= 0) {
+            QrCodeTrace::instant((iEncode[i] < 0 ? "cached " : "publish ") +
+                name, aOrigin + iPublished[i]);
+        }
+    }
+}
+
 QrCodeModel::Private::Private(
     QrCodeModel* aParent) :
     QObject(aParent),
-    iThreadPool(new QThreadPool(this)),
-    iTask(Q_NULLPTR)
+    iStrand(new QrCodeScheduler::Strand(this)),
+    iPriority(NormalPriority),
+    iTask(Q_NULLPTR),
+    iPending(0),
+    iTooLarge(0),
+    iStructuredAppend(false),
+    iMaxVersion(QrCodeGenerator::MaxVersion),
+    iMicroQr(false),
+    iOptimalSegmentation(false),
+    iComplete(true),
+    iSnapshot(QrCodeSnapshot::takeStartup()),
+    iTraceStart(0),
+    iCacheSize(0),
+    iCacheHits(0),
+    iCacheMisses(0),
+    iCacheEvictions(0)
 {
-    // Serialize the tasks for this model:
-    iThreadPool->setMaxThreadCount(1);
+    // Tasks for this model are serialized by the strand (each task
+    // spreads the work across the pool by itself)
 }
 
 QrCodeModel::Private::~Private()
 {
+    // Released task finishes (and gets deleted) on its own
     if (iTask) iTask->release();
-    iThreadPool->waitForDone();
 }
 
 inline
@@ -140,43 +570,201 @@ int
 QrCodeModel::Private::count() const
 {
     int n = 0;
-    for (int i = 0; i < HarbourQrCodeGenerator::ECLevelCount; i++) {
-        if (!iCode[i].isEmpty()) {
+    for (int i = 0; i < QrCodeModelSlotCount; i++) {
+        if (!iCode[i].isNull()) {
             n++;
         }
     }
     return n;
 }
 
-const QString*
+int
+QrCodeModel::Private::rowOf(
+    int aSlot) const
+{
+    // Number of rows preceding the given slot
+    int n = 0;
+    for (int r = 0; r < QrCodeModelSlotCount; r++) {
+        const int i = qrCodeModelRowOrder[r];
+        if (i == aSlot) {
+            break;
+        } else if (!iCode[i].isNull()) {
+            n++;
+        }
+    }
+    return n;
+}
+
+inline
+bool
+QrCodeModel::Private::isPending(
+    int aLevel) const
+{
+    return (iPending & (1u << aLevel)) != 0;
+}
+
+const QrCodeRegistry::Ref*
 QrCodeModel::Private::codeAt(
     int aRow,
-    HarbourQrCodeGenerator::ECLevel* aLevel) const
+    int* aSlot) const
 {
     int row = 0;
-    for (int i = 0; i < HarbourQrCodeGenerator::ECLevelCount; i++) {
-        const QString* code = iCode + i;
-        if (!code->isEmpty()) {
+    for (int r = 0; r < QrCodeModelSlotCount; r++) {
+        const int i = qrCodeModelRowOrder[r];
+        const QrCodeRegistry::Ref* code = iCode + i;
+        if (!code->isNull()) {
             if (row == aRow) {
-                if (aLevel) {
-                    *aLevel = (HarbourQrCodeGenerator::ECLevel)i;
+                if (aSlot) {
+                    *aSlot = i;
                 }
                 return code;
             }
             row++;
         }
     }
-    if (aLevel) {
-        *aLevel = HarbourQrCodeGenerator::ECLevelDefault;
+    if (aSlot) {
+        *aSlot = HarbourQrCodeGenerator::ECLevelDefault;
     }
     return Q_NULLPTR;
 }
 
+QStringList
+QrCodeModel::Private::sequenceAt(
+    int aRow) const
+{
+    // A single symbol is a sequence of one
+    int slot;
+    const QrCodeRegistry::Ref* code = codeAt(aRow, &slot);
+    QStringList ids;
+
+    if (code) {
+        const Sequence& sequence = iSequence[slot];
+        if (sequence.isEmpty()) {
+            ids.append(code->id());
+        } else {
+            for (int i = 0; i < sequence.count(); i++) {
+                ids.append(sequence.at(i).id());
+            }
+        }
+    }
+    return ids;
+}
+
+bool
+QrCodeModel::Private::sameBits(
+    const Sequence& aSequence1,
+    const Sequence& aSequence2)
+{
+    if (aSequence1.count() != aSequence2.count()) {
+        return false;
+    }
+    for (int i = 0; i < aSequence1.count(); i++) {
+        if (aSequence1.at(i).bits() != aSequence2.at(i).bits()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 QString
 QrCodeModel::Private::defaultCode() const
 {
-    const QString* code = codeAt(0);
-    return code ? QString(*code) : QString();
+    const QrCodeRegistry::Ref* code = codeAt(0);
+    return code ? code->id() : QString();
+}
+
+void
+QrCodeModel::Private::setCode(
+    int aLevel,
+    const QrCodeRegistry::Ref& aCode,
+    const Sequence& aSequence)
+{
+    QModelIndex parent;
+    QrCodeModel* model = parentModel();
+    const QString prevCode(defaultCode());
+    const bool wasPending = isPending(aLevel);
+    const int pos = rowOf(aLevel);
+    QrCodeRegistry::Ref* modelValue = iCode + aLevel;
+    Sequence* modelSequence = iSequence + aLevel;
+
+    iPending &= ~(1u << aLevel);
+    if (aLevel < QrCodeModelMicroSlot) {
+        // Nothing at all means that it didn't fit
+        setTooLarge(aCode.isNull() ? (iTooLarge | (1u << aLevel)) :
+            (iTooLarge & ~(1u << aLevel)));
+    }
+    if (modelValue->isNull()) {
+        if (!aCode.isNull()) {
+            // Inserting a new value
+            model->beginInsertRows(parent, pos, pos);
+            *modelValue = aCode;
+            *modelSequence = aSequence;
+            model->endInsertRows();
+        }
+    } else if (aCode.isNull()) {
+        // Removing the old value
+        model->beginRemoveRows(parent, pos, pos);
+        *modelValue = QrCodeRegistry::Ref();
+        modelSequence->clear();
+        model->endRemoveRows();
+    } else {
+        // Identical bits keep the old id, so that QML doesn't have
+        // to reload the image
+        QVector<int> roles;
+        if (modelValue->bits() != aCode.bits()) {
+            *modelValue = aCode;
+            roles.append(QrCodeRole);
+        }
+        if (!sameBits(*modelSequence, aSequence)) {
+            *modelSequence = aSequence;
+            roles.append(SequenceRole);
+        }
+        if (wasPending) {
+            roles.append(PendingRole);
+        }
+        if (!roles.isEmpty()) {
+            const QModelIndex index(model->index(pos));
+            Q_EMIT model->dataChanged(index, index, roles);
+        }
+    }
+
+    if (defaultCode() != prevCode) {
+        Q_EMIT model->qrcodeChanged();
+    }
+}
+
+void
+QrCodeModel::Private::setPending(
+    uint aPending)
+{
+    // Only the existing rows are affected by this
+    QrCodeModel* model = parentModel();
+    const uint changed = iPending ^ aPending;
+    QVector<int> roles;
+
+    roles.append(PendingRole);
+    iPending = aPending;
+    for (int r = 0, pos = 0; r < QrCodeModelSlotCount; r++) {
+        const int i = qrCodeModelRowOrder[r];
+        if (!iCode[i].isNull()) {
+            if (changed & (1u << i)) {
+                const QModelIndex index(model->index(pos));
+                Q_EMIT model->dataChanged(index, index, roles);
+            }
+            pos++;
+        }
+    }
+}
+
+void
+QrCodeModel::Private::setTooLarge(
+    uint aTooLarge)
+{
+    if (iTooLarge != aTooLarge) {
+        iTooLarge = aTooLarge;
+        HDEBUG("Too large for" << hex << iTooLarge);
+        Q_EMIT parentModel()->tooLargeChanged();
+    }
 }
 
 void
@@ -185,7 +773,7 @@ QrCodeModel::Private::setText(
 {
     if (iText != aText) {
         QrCodeModel* model = parentModel();
-        const bool prevCount = count();
+        const int prevCount = count();
 
         HDEBUG(aText);
         iText = aText;
@@ -193,76 +781,322 @@ QrCodeModel::Private::setText(
             // No text - no code. Just clear the model
             if (prevCount > 0) {
                 model->beginResetModel();
-                for (int i = 0; i < HarbourQrCodeGenerator::ECLevelCount; i++) {
-                    iCode[i].clear();
+                for (int i = 0; i < QrCodeModelSlotCount; i++) {
+                    iCode[i] = QrCodeRegistry::Ref();
+                    iSequence[i].clear();
                 }
+                iPending = 0;
                 model->endResetModel();
                 // It's empty now
                 Q_EMIT model->qrcodeChanged();
             }
+            setTooLarge(0);
             if (iTask) {
                 // Cancel the task
                 iTask->release();
                 iTask = Q_NULLPTR;
                 Q_EMIT model->runningChanged();
             }
-        } else {
-            // We actually need to generate a new code
-            const bool wasRunning = (iTask != Q_NULLPTR);
-            if (iTask) iTask->release();
-            iTask = new Task(iThreadPool, iText);
-            iTask->submit(this, SLOT(onTaskDone()));
-            if (!wasRunning) {
-                Q_EMIT model->runningChanged();
-            }
+        } else if (iComplete) {
+            generate();
         }
         Q_EMIT model->textChanged();
     }
 }
 
 void
-QrCodeModel::Private::onTaskDone()
+QrCodeModel::Private::generate()
 {
-    if (sender() == iTask) {
-        Task* task = iTask;
+    QrCodeModel* model = parentModel();
+    const bool wasRunning = (iTask != Q_NULLPTR);
+    uint missing = 0;
+
+    iClock.start();
+    iTraceStart = QrCodeTrace::now();
+    iLatency.clear();
+
+    if (iTask) {
+        iTask->release();
         iTask = Q_NULLPTR;
+    }
 
-        QModelIndex parent;
-        QrCodeModel* model = parentModel();
-        const QString prevCode(defaultCode());
-        for (int i = 0, pos = 0; i < HarbourQrCodeGenerator::ECLevelCount; i++) {
-            QString* modelValue = iCode + i;
-            const QString* newValue = task->iCode + i;
-            if (modelValue->compare(*newValue) != 0) {
-                if (modelValue->isEmpty()) {
-                    // Inserting a new value
-                    model->beginInsertRows(parent, pos, pos);
-                    *modelValue = *newValue;
-                    model->endInsertRows();
-                    pos++;
-                } else if (newValue->isEmpty()) {
-                    // Removing the old value
-                    model->beginRemoveRows(parent, pos, pos);
-                    modelValue->clear();
-                    model->endRemoveRows();
-                    // Current position remains the same
-                } else {
-                    // The value has changed
-                    *modelValue = *newValue;
-                    QVector<int> roles;
-                    roles.append(QrCodeRole);
-                    const QModelIndex index(model->index(pos));
-                    model->dataChanged(index, index, roles);
-                    pos++;
+    // Whatever is currently there, is about to be replaced
+    setPending((1u << QrCodeModelSlotCount) - 1);
+    restoreSnapshot();
+
+    // Cached levels are published right away
+    const int slots = iMicroQr ? QrCodeModelSlotCount : QrCodeModelMicroSlot;
+    for (int i = 0; i < slots; i++) {
+        QrCodeRegistry::Ref code;
+        Sequence sequence;
+        if (iCache.find(iText, i, iOptimalSegmentation, &code, &sequence)) {
+            setCode(i, code, sequence);
+            iLatency.iPublished[i] = iClock.nsecsElapsed();
+        } else {
+            missing |= (1u << i);
+        }
+    }
+
+    if (missing) {
+        // We actually need to generate a new code
+        HDEBUG("Generating levels" << hex << missing);
+        iTask = new Task(QrCodeScheduler::pool(), iText, missing,
+            iStructuredAppend ? iMaxVersion : 0, iOptimalSegmentation,
+            iStrand->priority());
+        connect(iTask, SIGNAL(levelDone(int,QByteArray)),
+            SLOT(onLevelDone(int,QByteArray)),
+            Qt::QueuedConnection);
+        connect(iTask, SIGNAL(sequenceDone(int,QByteArrayList)),
+            SLOT(onSequenceDone(int,QByteArrayList)),
+            Qt::QueuedConnection);
+        iTask->iClock = iClock;
+        iStrand->submit(iTask, this, SLOT(onTaskDone()));
+        iLatency.iQueued = iClock.nsecsElapsed();
+    } else {
+        latencyDone();
+    }
+
+    if (wasRunning != (iTask != Q_NULLPTR)) {
+        Q_EMIT model->runningChanged();
+    }
+    updateCacheStats();
+}
+
+void
+QrCodeModel::Private::setStructuredAppend(
+    bool aStructuredAppend)
+{
+    if (iStructuredAppend != aStructuredAppend) {
+        iStructuredAppend = aStructuredAppend;
+        HDEBUG(iStructuredAppend);
+        // Cached codes may have been generated the other way
+        iCache.clear();
+        if (iComplete && !iText.isEmpty()) {
+            generate();
+        }
+        Q_EMIT parentModel()->structuredAppendChanged();
+    }
+}
+
+void
+QrCodeModel::Private::setMaxVersion(
+    int aVersion)
+{
+    const int version = qBound(1, aVersion, (int)QrCodeGenerator::MaxVersion);
+
+    if (iMaxVersion != version) {
+        iMaxVersion = version;
+        HDEBUG(iMaxVersion);
+        if (iStructuredAppend) {
+            iCache.clear();
+            if (iComplete && !iText.isEmpty()) {
+                generate();
+            }
+        }
+        Q_EMIT parentModel()->maxVersionChanged();
+    }
+}
+
+void
+QrCodeModel::Private::setMicroQr(
+    bool aMicroQr)
+{
+    if (iMicroQr != aMicroQr) {
+        iMicroQr = aMicroQr;
+        HDEBUG(iMicroQr);
+        if (iMicroQr) {
+            if (iComplete && !iText.isEmpty()) {
+                generate();
+            }
+        } else {
+            // The ones being generated will be dropped when they arrive
+            for (int i = QrCodeModelMicroSlot; i < QrCodeModelSlotCount; i++) {
+                setCode(i, QrCodeRegistry::Ref());
+            }
+        }
+        Q_EMIT parentModel()->microQrChanged();
+    }
+}
+
+void
+QrCodeModel::Private::setOptimalSegmentation(
+    bool aOptimalSegmentation)
+{
+    if (iOptimalSegmentation != aOptimalSegmentation) {
+        iOptimalSegmentation = aOptimalSegmentation;
+        HDEBUG(iOptimalSegmentation);
+        // The segmentation is a part of the cache key, the codes
+        // generated the other way stay in the cache
+        if (iComplete && !iText.isEmpty()) {
+            generate();
+        }
+        Q_EMIT parentModel()->optimalSegmentationChanged();
+    }
+}
+
+void
+QrCodeModel::Private::setPriority(
+    Priority aPriority)
+{
+    if (iPriority != aPriority) {
+        iPriority = aPriority;
+        HDEBUG(iPriority);
+        switch (aPriority) {
+        case LowPriority:
+            iStrand->setPriority(QrCodeScheduler::PriorityLow);
+            break;
+        case NormalPriority:
+            iStrand->setPriority(QrCodeScheduler::PriorityNormal);
+            break;
+        case HighPriority:
+            iStrand->setPriority(QrCodeScheduler::PriorityHigh);
+            break;
+        }
+        Q_EMIT parentModel()->priorityChanged();
+    }
+}
+
+void
+QrCodeModel::Private::setCacheCapacity(
+    int aCapacity)
+{
+    if (iCache.capacity() != aCapacity) {
+        iCache.setCapacity(aCapacity);
+        HDEBUG(iCache.capacity() << "bytes");
+        Q_EMIT parentModel()->cacheCapacityChanged();
+        updateCacheStats();
+    }
+}
+
+void
+QrCodeModel::Private::restoreSnapshot()
+{
+    // Only the first text gets a chance to match the snapshot. Matching
+    // codes are put to the cache and get published from there.
+    if (!iSnapshot.isEmpty()) {
+        if (iSnapshot.matches(iText, iStructuredAppend, iMaxVersion, iMicroQr,
+            iOptimalSegmentation)) {
+            const QList<int> levels(iSnapshot.levels());
+
+            HDEBUG("Restoring" << levels.count() << "level(s)");
+            for (int i = 0; i < levels.count(); i++) {
+                const int level = levels.at(i);
+                if (level >= 0 && level < QrCodeModelSlotCount) {
+                    const QrCodeSnapshot::Symbols symbols(iSnapshot.symbols(level));
+                    Sequence sequence;
+
+                    if (symbols.count() > 1) {
+                        for (int k = 0; k < symbols.count(); k++) {
+                            sequence.append(QrCodeRegistry::Ref(symbols.at(k)));
+                        }
+                    }
+                    iCache.insert(iText, level, iOptimalSegmentation,
+                        sequence.isEmpty() ?
+                        QrCodeRegistry::Ref(symbols.value(0)) :
+                        sequence.first(), sequence);
                 }
             }
         }
+        iSnapshot = QrCodeSnapshot();
+    }
+}
+
+void
+QrCodeModel::Private::updateCacheStats()
+{
+    const int size = iCache.size();
+    const uint hits = iCache.hits();
+    const uint misses = iCache.misses();
+    const uint evictions = iCache.evictions();
+
+    if (iCacheSize != size || iCacheHits != hits || iCacheMisses != misses ||
+        iCacheEvictions != evictions) {
+        iCacheSize = size;
+        iCacheHits = hits;
+        iCacheMisses = misses;
+        iCacheEvictions = evictions;
+        Q_EMIT parentModel()->cacheStatsChanged();
+    }
+}
+
+void
+QrCodeModel::Private::levelPublished(
+    int aLevel)
+{
+    // Timing has been recorded by the task before the level was queued
+    iLatency.iLevelStart[aLevel] = iTask->iLevelStart[aLevel];
+    iLatency.iEncode[aLevel] = iTask->iTiming[aLevel].iEncode;
+    iLatency.iPack[aLevel] = iTask->iTiming[aLevel].iPack;
+    iLatency.iPublished[aLevel] = iClock.nsecsElapsed();
+}
+
+void
+QrCodeModel::Private::latencyDone()
+{
+    iLatency.iDone = iClock.nsecsElapsed();
+    HDEBUG("Done in" << iLatency.iDone / 1000000.0 << "ms");
+    if (QrCodeTrace::isEnabled()) {
+        iLatency.trace(iTraceStart, iText.length());
+    }
+    Q_EMIT parentModel()->latencyChanged();
+    Q_EMIT parentModel()->generated();
+}
 
-        task->release();
-        if (defaultCode() != prevCode) {
-            Q_EMIT model->qrcodeChanged();
+void
+QrCodeModel::Private::onLevelDone(
+    int aLevel,
+    QByteArray aBits)
+{
+    // Results of the cancelled tasks are ignored
+    if (sender() == iTask) {
+        const QrCodeRegistry::Ref code(aBits);
+
+        HDEBUG("Level" << aLevel << "done" << code.id());
+        iCache.insert(iTask->iText, aLevel, iTask->iOptimalSegmentation, code);
+        if (aLevel < QrCodeModelMicroSlot || iMicroQr) {
+            setCode(aLevel, code);
         }
-        Q_EMIT model->runningChanged();
+        updateCacheStats();
+        levelPublished(aLevel);
+    }
+}
+
+void
+QrCodeModel::Private::onSequenceDone(
+    int aLevel,
+    QByteArrayList aBits)
+{
+    if (sender() == iTask) {
+        Sequence sequence;
+
+        for (int i = 0; i < aBits.count(); i++) {
+            sequence.append(QrCodeRegistry::Ref(aBits.at(i)));
+        }
+
+        // The first symbol represents the whole sequence
+        const QrCodeRegistry::Ref code(sequence.isEmpty() ?
+            QrCodeRegistry::Ref() : sequence.first());
+
+        HDEBUG("Level" << aLevel << "done," << sequence.count() << "symbols");
+        iCache.insert(iTask->iText, aLevel, iTask->iOptimalSegmentation,
+            code, sequence);
+        setCode(aLevel, code, sequence);
+        updateCacheStats();
+        levelPublished(aLevel);
+    }
+}
+
+void
+QrCodeModel::Private::onTaskDone()
+{
+    if (sender() == iTask) {
+        iLatency.iStarted = iTask->iStarted;
+        iTask->release();
+        iTask = Q_NULLPTR;
+        // All levels must have been published by now
+        setPending(0);
+        latencyDone();
+        Q_EMIT parentModel()->runningChanged();
     }
 }
 
@@ -307,12 +1141,191 @@ QrCodeModel::isRunning() const
     return iPrivate->iTask != Q_NULLPTR;
 }
 
+bool
+QrCodeModel::isStructuredAppend() const
+{
+    return iPrivate->iStructuredAppend;
+}
+
+void
+QrCodeModel::setStructuredAppend(
+    bool aValue)
+{
+    iPrivate->setStructuredAppend(aValue);
+}
+
+int
+QrCodeModel::getMaxVersion() const
+{
+    return iPrivate->iMaxVersion;
+}
+
+void
+QrCodeModel::setMaxVersion(
+    int aVersion)
+{
+    iPrivate->setMaxVersion(aVersion);
+}
+
+bool
+QrCodeModel::isMicroQr() const
+{
+    return iPrivate->iMicroQr;
+}
+
+void
+QrCodeModel::setMicroQr(
+    bool aValue)
+{
+    iPrivate->setMicroQr(aValue);
+}
+
+bool
+QrCodeModel::isOptimalSegmentation() const
+{
+    return iPrivate->iOptimalSegmentation;
+}
+
+void
+QrCodeModel::setOptimalSegmentation(
+    bool aValue)
+{
+    iPrivate->setOptimalSegmentation(aValue);
+}
+
+QrCodeModel::Priority
+QrCodeModel::getPriority() const
+{
+    return iPrivate->iPriority;
+}
+
+void
+QrCodeModel::setPriority(
+    Priority aPriority)
+{
+    iPrivate->setPriority(aPriority);
+}
+
+QList<int>
+QrCodeModel::getTooLarge() const
+{
+    QList<int> levels;
+
+    for (int i = 0; i < HarbourQrCodeGenerator::ECLevelCount; i++) {
+        if (iPrivate->iTooLarge & (1u << i)) {
+            levels.append(i);
+        }
+    }
+    return levels;
+}
+
+int
+QrCodeModel::getCacheCapacity() const
+{
+    return iPrivate->iCache.capacity();
+}
+
+void
+QrCodeModel::setCacheCapacity(
+    int aBytes)
+{
+    iPrivate->setCacheCapacity(aBytes);
+}
+
+int
+QrCodeModel::getCacheSize() const
+{
+    return iPrivate->iCacheSize;
+}
+
+uint
+QrCodeModel::getCacheHits() const
+{
+    return iPrivate->iCacheHits;
+}
+
+uint
+QrCodeModel::getCacheMisses() const
+{
+    return iPrivate->iCacheMisses;
+}
+
+uint
+QrCodeModel::getCacheEvictions() const
+{
+    return iPrivate->iCacheEvictions;
+}
+
+QVariantMap
+QrCodeModel::getLatency() const
+{
+    return iPrivate->iLatency.toVariantMap();
+}
+
+QByteArray
+QrCodeModel::codeBits(
+    int aLevel) const
+{
+    return (aLevel >= 0 && aLevel < QrCodeModelMicroSlot &&
+        iPrivate->iSequence[aLevel].isEmpty()) ?
+        iPrivate->iCode[aLevel].bits() : QByteArray();
+}
+
+QrCodeSnapshot
+QrCodeModel::snapshot() const
+{
+    // Nothing to save while the codes are still being generated
+    if (!iPrivate->iTask && !iPrivate->iText.isEmpty()) {
+        QrCodeSnapshot snapshot(iPrivate->iText, iPrivate->iStructuredAppend,
+            iPrivate->iMaxVersion, iPrivate->iMicroQr,
+            iPrivate->iOptimalSegmentation);
+        const int n = iPrivate->iMicroQr ? QrCodeModelSlotCount :
+            QrCodeModelMicroSlot;
+
+        for (int i = 0; i < n; i++) {
+            const Private::Sequence& sequence = iPrivate->iSequence[i];
+            QrCodeSnapshot::Symbols symbols;
+
+            if (!sequence.isEmpty()) {
+                for (int k = 0; k < sequence.count(); k++) {
+                    symbols.append(sequence.at(k).bits());
+                }
+            } else if (!iPrivate->iCode[i].isNull()) {
+                symbols.append(iPrivate->iCode[i].bits());
+            }
+            snapshot.insert(i, symbols);
+        }
+        return snapshot;
+    }
+    return QrCodeSnapshot();
+}
+
+void
+QrCodeModel::classBegin()
+{
+    // Don't start generating anything until all properties are set
+    iPrivate->iComplete = false;
+}
+
+void
+QrCodeModel::componentComplete()
+{
+    iPrivate->iComplete = true;
+    if (!iPrivate->iText.isEmpty()) {
+        iPrivate->generate();
+    }
+}
+
 QHash<int,QByteArray>
 QrCodeModel::roleNames() const
 {
     QHash<int,QByteArray> roles;
     roles.insert(Private::QrCodeRole, "qrcode");
     roles.insert(Private::EcLevelRole, "eclevel");
+    roles.insert(Private::PendingRole, "pending");
+    roles.insert(Private::SequenceRole, "sequence");
+    roles.insert(Private::ModulesRole, "modules");
+    roles.insert(Private::MicroRole, "micro");
     return roles;
 }
 
@@ -329,12 +1342,18 @@ QrCodeModel::data(
     int aRole) const
 {
     const int row = aIndex.row();
-    HarbourQrCodeGenerator::ECLevel ecLevel;
-    const QString* qrCode = iPrivate->codeAt(row, &ecLevel);
+    int slot;
+    const QrCodeRegistry::Ref* qrCode = iPrivate->codeAt(row, &slot);
     if (qrCode) {
+        const bool micro = (slot >= QrCodeModelMicroSlot);
         switch ((Private::Role)aRole) {
-        case Private::QrCodeRole: return *qrCode;
-        case Private::EcLevelRole: return ecLevel;
+        case Private::QrCodeRole: return qrCode->id();
+        case Private::EcLevelRole: return micro ? (slot - QrCodeModelMicroSlot) : slot;
+        case Private::PendingRole: return iPrivate->isPending(slot);
+        case Private::SequenceRole: return iPrivate->sequenceAt(row);
+        case Private::ModulesRole:
+            return QrCodeImageProvider::moduleCount(qrCode->bits());
+        case Private::MicroRole: return micro;
         }
     }
     return QVariant();
@@ -40,17 +40,45 @@
 #ifndef QRCODE_MODEL_H
 #define QRCODE_MODEL_H
 
+#include "QrCodeSnapshot.h"
+
 #include <QtCore/QAbstractListModel>
+#include <QtCore/QVariantMap>
+
+#include <QtQml/QQmlParserStatus>
 
 class QrCodeModel :
-    public QAbstractListModel
+    public QAbstractListModel,
+    public QQmlParserStatus
 {
     Q_OBJECT
+    Q_INTERFACES(QQmlParserStatus)
     Q_PROPERTY(QString text READ getText WRITE setText NOTIFY textChanged)
     Q_PROPERTY(QString qrcode READ getQrCode NOTIFY qrcodeChanged)
     Q_PROPERTY(bool running READ isRunning NOTIFY runningChanged)
+    Q_PROPERTY(bool structuredAppend READ isStructuredAppend WRITE setStructuredAppend NOTIFY structuredAppendChanged)
+    Q_PROPERTY(int maxVersion READ getMaxVersion WRITE setMaxVersion NOTIFY maxVersionChanged)
+    Q_PROPERTY(bool microQr READ isMicroQr WRITE setMicroQr NOTIFY microQrChanged)
+    Q_PROPERTY(bool optimalSegmentation READ isOptimalSegmentation WRITE setOptimalSegmentation NOTIFY optimalSegmentationChanged)
+    Q_PROPERTY(Priority priority READ getPriority WRITE setPriority NOTIFY priorityChanged)
+    Q_PROPERTY(QList<int> tooLarge READ getTooLarge NOTIFY tooLargeChanged)
+    Q_PROPERTY(int cacheCapacity READ getCacheCapacity WRITE setCacheCapacity NOTIFY cacheCapacityChanged)
+    Q_PROPERTY(int cacheSize READ getCacheSize NOTIFY cacheStatsChanged)
+    Q_PROPERTY(uint cacheHits READ getCacheHits NOTIFY cacheStatsChanged)
+    Q_PROPERTY(uint cacheMisses READ getCacheMisses NOTIFY cacheStatsChanged)
+    Q_PROPERTY(uint cacheEvictions READ getCacheEvictions NOTIFY cacheStatsChanged)
+    Q_PROPERTY(QVariantMap latency READ getLatency NOTIFY latencyChanged)
+    Q_ENUMS(Priority)
 
 public:
+    // Models share the worker threads. When they are all busy, the
+    // codes for the models with higher priority are generated first.
+    enum Priority {
+        LowPriority,
+        NormalPriority,
+        HighPriority
+    };
+
     QrCodeModel(QObject* aParent = Q_NULLPTR);
     ~QrCodeModel();
 
@@ -59,6 +87,61 @@ public:
     QString getQrCode() const;
     bool isRunning() const;
 
+    // With structured append enabled, the text which doesn't fit into
+    // a single symbol of the maximum version is split into up to 16 of
+    // them, see the "sequence" role
+    bool isStructuredAppend() const;
+    void setStructuredAppend(bool);
+    int getMaxVersion() const;
+    void setMaxVersion(int);
+
+    // With Micro QR enabled, short texts also get M1-M4 symbols (levels
+    // L, M and Q, where they fit). Those rows have the "micro" role set
+    // and come after the regular ones. Off by default.
+    bool isMicroQr() const;
+    void setMicroQr(bool);
+
+    // With the optimal segmentation, the text is split into the shortest
+    // sequence of numeric, alphanumeric, byte and kanji segments, which
+    // may result in a smaller symbol. Non-ASCII text gets a UTF-8 ECI
+    // header or may end up in kanji mode, which not every scanner can
+    // handle, hence it's off by default (libqrencode's own splitter).
+    bool isOptimalSegmentation() const;
+    void setOptimalSegmentation(bool);
+
+    Priority getPriority() const;
+    void setPriority(Priority);
+
+    // EC levels which the text is too large for. Most of them are known
+    // as soon as the text changes (without encoding anything), the rest
+    // are added if the encoder fails later on.
+    QList<int> getTooLarge() const;
+
+    int getCacheCapacity() const;
+    void setCacheCapacity(int);
+    int getCacheSize() const;
+    uint getCacheHits() const;
+    uint getCacheMisses() const;
+    uint getCacheEvictions() const;
+
+    // Milliseconds since the text change: "queued", "started", "done"
+    // and the list of "levels", each with "eclevel", "micro", "cached",
+    // "started", "encode", "pack" and "published"
+    QVariantMap getLatency() const;
+
+    // Packed bits of a single-symbol level, empty if the level isn't
+    // available (or is a structured append sequence)
+    QByteArray codeBits(int) const;
+
+    // Codes for the current text, empty while they are being generated.
+    // The startup snapshot (if any) is picked up by the constructor and
+    // used instead of generating the codes if the first text matches.
+    QrCodeSnapshot snapshot() const;
+
+    // QQmlParserStatus
+    void classBegin() Q_DECL_OVERRIDE;
+    void componentComplete() Q_DECL_OVERRIDE;
+
     // QAbstractItemModel
     QHash<int,QByteArray> roleNames() const Q_DECL_OVERRIDE;
     int rowCount(const QModelIndex&) const Q_DECL_OVERRIDE;
@@ -68,6 +151,16 @@ Q_SIGNALS:
     void textChanged();
     void qrcodeChanged();
     void runningChanged();
+    void structuredAppendChanged();
+    void maxVersionChanged();
+    void microQrChanged();
+    void optimalSegmentationChanged();
+    void priorityChanged();
+    void tooLargeChanged();
+    void cacheCapacityChanged();
+    void cacheStatsChanged();
+    void latencyChanged();
+    void generated();
 
 private:
     class Task;
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "QrCodeRegistry.h"
+#include "QrCodeArena.h"
+
+#include "HarbourBase32.h"
+#include "HarbourDebug.h"
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+
+// The prefix must not be a valid base32 character
+#define QRCODE_ID_PREFIX '@'
+#define QRCODE_ID_BASE 36
+
+// ==========================================================================
+// QrCodeRegistry::Entry
+// ==========================================================================
+
+class QrCodeRegistry::Entry
+{
+public:
+    Entry(quint32, const QByteArray&);
+
+public:
+    QAtomicInt iRef;
+    const quint32 iId;
+    const QString iIdString;
+    const QByteArray iBits;
+};
+
+QrCodeRegistry::Entry::Entry(
+    quint32 aId,
+    const QByteArray& aBits) :
+    iRef(1),
+    iId(aId),
+    iIdString(QChar(QRCODE_ID_PREFIX) + QString::number(aId, QRCODE_ID_BASE)),
+    iBits(aBits)
+{
+}
+
+// ==========================================================================
+// QrCodeRegistry::Private
+// ==========================================================================
+
+class QrCodeRegistry::Private
+{
+public:
+    Private();
+
+    Entry* add(const QByteArray&);
+    void remove(Entry*);
+    QByteArray find(quint32);
+    int count();
+
+public:
+    QMutex iMutex;
+    quint32 iLastId;
+    QHash<quint32,Entry*> iEntries;
+};
+
+Q_GLOBAL_STATIC(QrCodeRegistry::Private, qrCodeRegistry)
+
+QrCodeRegistry::Private::Private() :
+    iLastId(0)
+{
+}
+
+QrCodeRegistry::Entry*
+QrCodeRegistry::Private::add(
+    const QByteArray& aBits)
+{
+    QMutexLocker lock(&iMutex);
+
+    // Zero is not a valid id
+    do { iLastId++; } while (!iLastId || iEntries.contains(iLastId));
+    Entry* entry = new Entry(iLastId, aBits);
+    iEntries.insert(entry->iId, entry);
+    return entry;
+}
+
+void
+QrCodeRegistry::Private::remove(
+    Entry* aEntry)
+{
+    iMutex.lock();
+    iEntries.remove(aEntry->iId);
+    iMutex.unlock();
+    // Nobody can find it anymore
+    delete aEntry;
+}
+
+QByteArray
+QrCodeRegistry::Private::find(
+    quint32 aId)
+{
+    QMutexLocker lock(&iMutex);
+    const Entry* entry = iEntries.value(aId);
+
+    // The entry may have just been released but it's not deleted
+    // until it's removed from the table, under the same lock
+    return entry ? entry->iBits : QByteArray();
+}
+
+int
+QrCodeRegistry::Private::count()
+{
+    QMutexLocker lock(&iMutex);
+
+    return iEntries.count();
+}
+
+// ==========================================================================
+// QrCodeRegistry::Ref
+// ==========================================================================
+
+QrCodeRegistry::Ref::Ref() :
+    iEntry(Q_NULLPTR)
+{
+}
+
+QrCodeRegistry::Ref::Ref(
+    const QByteArray& aBits) :
+    iEntry(aBits.isEmpty() ? Q_NULLPTR : qrCodeRegistry()->add(aBits))
+{
+}
+
+QrCodeRegistry::Ref::Ref(
+    const Ref& aRef) :
+    iEntry(aRef.iEntry)
+{
+    if (iEntry) iEntry->iRef.ref();
+}
+
+QrCodeRegistry::Ref::~Ref()
+{
+    if (iEntry && !iEntry->iRef.deref()) {
+        qrCodeRegistry()->remove(iEntry);
+    }
+}
+
+QrCodeRegistry::Ref&
+QrCodeRegistry::Ref::operator=(
+    const Ref& aRef)
+{
+    if (iEntry != aRef.iEntry) {
+        if (aRef.iEntry) aRef.iEntry->iRef.ref();
+        if (iEntry && !iEntry->iRef.deref()) {
+            qrCodeRegistry()->remove(iEntry);
+        }
+        iEntry = aRef.iEntry;
+    }
+    return *this;
+}
+
+bool
+QrCodeRegistry::Ref::operator==(
+    const Ref& aRef) const
+{
+    return iEntry == aRef.iEntry;
+}
+
+bool
+QrCodeRegistry::Ref::operator!=(
+    const Ref& aRef) const
+{
+    return iEntry != aRef.iEntry;
+}
+
+bool
+QrCodeRegistry::Ref::isNull() const
+{
+    return !iEntry;
+}
+
+QString
+QrCodeRegistry::Ref::id() const
+{
+    return iEntry ? iEntry->iIdString : QString();
+}
+
+QByteArray
+QrCodeRegistry::Ref::bits() const
+{
+    return iEntry ? iEntry->iBits : QByteArray();
+}
+
+// ==========================================================================
+// QrCodeRegistry
+// ==========================================================================
+
+bool
+QrCodeRegistry::isId(
+    const QString& aCode)
+{
+    return aCode.length() > 1 && aCode.at(0) == QChar(QRCODE_ID_PREFIX);
+}
+
+QByteArray
+QrCodeRegistry::find(
+    const QString& aCode)
+{
+    if (isId(aCode)) {
+        bool ok;
+        const quint32 id = aCode.mid(1).toUInt(&ok, QRCODE_ID_BASE);
+        if (ok) {
+            return qrCodeRegistry()->find(id);
+        }
+        HDEBUG("Invalid id" << aCode);
+        return QByteArray();
+    } else if (QrCodeArena::isId(aCode)) {
+        // Long-lived codes, e.g. from the history
+        return QrCodeArena::find(aCode);
+    } else {
+        // Still support base32 encoded bits
+        return HarbourBase32::fromBase32(aCode.toLocal8Bit());
+    }
+}
+
+int
+QrCodeRegistry::count()
+{
+    return qrCodeRegistry()->count();
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#ifndef QRCODE_REGISTRY_H
+#define QRCODE_REGISTRY_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+
+// Process-wide registry of generated codes. Each code gets a short id
+// which can be passed around (e.g. to QML and back to the image provider)
+// instead of the base32 encoded bits. The code stays registered for as
+// long as there's at least one reference to it. find() resolves
+// QrCodeArena ids too. All static functions are thread-safe.
+class QrCodeRegistry
+{
+public:
+    class Entry;
+    class Private;
+    class Ref {
+    public:
+        Ref();
+        Ref(const QByteArray&);
+        Ref(const Ref&);
+        ~Ref();
+
+        Ref& operator=(const Ref&);
+        bool operator==(const Ref&) const;
+        bool operator!=(const Ref&) const;
+
+        bool isNull() const;
+        QString id() const;
+        QByteArray bits() const;
+
+    private:
+        Entry* iEntry;
+    };
+
+    static bool isId(const QString&);
+    static QByteArray find(const QString&);
+    static int count();
+
+private:
+    QrCodeRegistry();
+};
+
+#endif // QRCODE_REGISTRY_H
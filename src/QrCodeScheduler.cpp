@@ -0,0 +1,358 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "QrCodeScheduler.h"
+
+#include "HarbourTask.h"
+#include "HarbourDebug.h"
+
+#include <QtCore/QThreadPool>
+
+// ==========================================================================
+// QrCodeScheduler::Private
+// ==========================================================================
+
+class QrCodeScheduler::Private
+{
+public:
+    Private();
+
+    void ready(Strand*);
+    void remove(Strand*);
+    void finished();
+    void dispatch();
+
+public:
+    // Strands which have something to run and aren't running anything
+    QList<Strand*> iReady;
+    int iRunning;
+};
+
+// Only touched by the main thread
+static QrCodeScheduler::Private qrCodeScheduler;
+
+QrCodeScheduler::Private::Private() :
+    iRunning(0)
+{
+}
+
+void
+QrCodeScheduler::Private::ready(
+    Strand* aStrand)
+{
+    if (!iReady.contains(aStrand)) {
+        iReady.append(aStrand);
+    }
+    dispatch();
+}
+
+void
+QrCodeScheduler::Private::remove(
+    Strand* aStrand)
+{
+    iReady.removeAll(aStrand);
+}
+
+void
+QrCodeScheduler::Private::finished()
+{
+    iRunning--;
+    dispatch();
+}
+
+void
+QrCodeScheduler::Private::dispatch()
+{
+    // Tasks are only submitted to the pool when there's a thread to
+    // run them, so that the ones submitted later but with the higher
+    // priority don't get stuck in the pool's queue behind them. The
+    // tasks being run may still spread the work across the same pool.
+    const int max = qMax(pool()->maxThreadCount(), 1);
+
+    while (iRunning < max && !iReady.isEmpty()) {
+        int next = 0;
+        for (int i = 1; i < iReady.count(); i++) {
+            if (iReady.at(i)->iPriority > iReady.at(next)->iPriority) {
+                next = i;
+            }
+        }
+        iRunning++;
+        iReady.takeAt(next)->start();
+    }
+}
+
+// ==========================================================================
+// QrCodeScheduler::Strand
+// ==========================================================================
+
+QrCodeScheduler::Strand::Strand(
+    QObject* aParent,
+    QrCodeScheduler::Priority aPriority) :
+    QObject(aParent),
+    iPriority(aPriority),
+    iRunning(Q_NULLPTR)
+{
+}
+
+QrCodeScheduler::Strand::~Strand()
+{
+    // The tasks themselves belong to whoever has submitted them. The
+    // queued ones are submitted right away (they must be released by
+    // now, and therefore finish quickly) and the running one is
+    // considered finished as far as the scheduler is concerned.
+    qrCodeScheduler.remove(this);
+    for (int i = 0; i < iQueue.count(); i++) {
+        HarbourTask* task = iQueue.at(i);
+        task->disconnect(this);
+        task->submit();
+    }
+    if (iRunning) {
+        iRunning->disconnect(this);
+        qrCodeScheduler.finished();
+    }
+}
+
+QrCodeScheduler::Priority
+QrCodeScheduler::Strand::priority() const
+{
+    return iPriority;
+}
+
+void
+QrCodeScheduler::Strand::setPriority(
+    QrCodeScheduler::Priority aPriority)
+{
+    // Affects the queued tasks, the running one keeps running
+    iPriority = aPriority;
+}
+
+bool
+QrCodeScheduler::Strand::isIdle() const
+{
+    return !iRunning && iQueue.isEmpty();
+}
+
+void
+QrCodeScheduler::Strand::submit(
+    HarbourTask* aTask,
+    QObject* aTarget,
+    const char* aSlot)
+{
+    // Released tasks don't emit done() but get deleted when they are
+    // finished (or right away, if they haven't been submitted yet)
+    connect(aTask, SIGNAL(done()), SLOT(onTaskFinished()));
+    connect(aTask, SIGNAL(destroyed(QObject*)), SLOT(onTaskFinished()));
+    if (aTarget && aSlot) {
+        aTarget->connect(aTask, SIGNAL(done()), aSlot);
+    }
+    iQueue.append(aTask);
+    if (!iRunning) {
+        qrCodeScheduler.ready(this);
+    }
+}
+
+void
+QrCodeScheduler::Strand::start()
+{
+    // Invoked by the scheduler when a thread is available
+    iRunning = iQueue.takeFirst();
+    iRunning->submit();
+}
+
+void
+QrCodeScheduler::Strand::onTaskFinished()
+{
+    QObject* task = sender();
+
+    if (task == iRunning) {
+        iRunning->disconnect(this);
+        iRunning = Q_NULLPTR;
+        if (!iQueue.isEmpty()) {
+            // The next one is queued behind the tasks of other strands
+            // with the same priority
+            qrCodeScheduler.iReady.append(this);
+        }
+        qrCodeScheduler.finished();
+    } else {
+        // Released before it had a chance to run
+        for (int i = 0; i < iQueue.count(); i++) {
+            if (iQueue.at(i) == task) {
+                iQueue.removeAt(i);
+                break;
+            }
+        }
+        if (iQueue.isEmpty() && !iRunning) {
+            qrCodeScheduler.remove(this);
+        }
+    }
+}
+
+// ==========================================================================
+// QrCodeScheduler::PriorityScope
+// ==========================================================================
+
+// Priority of whatever the thread is running
+static __thread int qrCodeSchedulerPriority = QrCodeScheduler::PriorityNormal;
+
+QrCodeScheduler::PriorityScope::PriorityScope(
+    QrCodeScheduler::Priority aPriority) :
+    iPrevious(currentPriority())
+{
+    qrCodeSchedulerPriority = aPriority;
+}
+
+QrCodeScheduler::PriorityScope::~PriorityScope()
+{
+    qrCodeSchedulerPriority = iPrevious;
+}
+
+// ==========================================================================
+// QrCodeScheduler::Job
+//
+// The pool keeps a pointer to the job until it has run it, even if the
+// job has been claimed and run by the waiting thread in the meantime,
+// hence the reference count: one reference for the owner, one for the
+// pool. The pool's run() of a claimed job does nothing.
+// ==========================================================================
+
+enum QrCodeSchedulerJobState {
+    QrCodeSchedulerJobQueued,
+    QrCodeSchedulerJobRunning,
+    QrCodeSchedulerJobDone
+};
+
+QrCodeScheduler::Job::Job() :
+    iPriority(PriorityNormal),
+    iState(QrCodeSchedulerJobQueued),
+    iRef(1)
+{
+    setAutoDelete(false);
+}
+
+QrCodeScheduler::Job::~Job()
+{
+}
+
+void
+QrCodeScheduler::Job::start(
+    QrCodeScheduler::Priority aPriority)
+{
+    iPriority = aPriority;
+    iRef.ref();
+    pool()->start(this, aPriority);
+}
+
+bool
+QrCodeScheduler::Job::claim()
+{
+    return iState.testAndSetOrdered(QrCodeSchedulerJobQueued,
+        QrCodeSchedulerJobRunning);
+}
+
+void
+QrCodeScheduler::Job::execute()
+{
+    PriorityScope scope(iPriority);
+
+    perform();
+    iMutex.lock();
+    iState.storeRelease(QrCodeSchedulerJobDone);
+    iDone.wakeAll();
+    iMutex.unlock();
+}
+
+void
+QrCodeScheduler::Job::run()
+{
+    // Invoked by the pool
+    if (claim()) {
+        execute();
+    }
+    unref();
+}
+
+void
+QrCodeScheduler::Job::wait()
+{
+    if (claim()) {
+        // Nobody has picked it up yet
+        execute();
+    } else {
+        iMutex.lock();
+        while (iState.loadAcquire() != QrCodeSchedulerJobDone) {
+            iDone.wait(&iMutex);
+        }
+        iMutex.unlock();
+    }
+}
+
+void
+QrCodeScheduler::Job::release()
+{
+    unref();
+}
+
+void
+QrCodeScheduler::Job::unref()
+{
+    if (!iRef.deref()) {
+        delete this;
+    }
+}
+
+// ==========================================================================
+// QrCodeScheduler
+// ==========================================================================
+
+QThreadPool*
+QrCodeScheduler::pool()
+{
+    return QThreadPool::globalInstance();
+}
+
+int
+QrCodeScheduler::runningCount()
+{
+    return qrCodeScheduler.iRunning;
+}
+
+QrCodeScheduler::Priority
+QrCodeScheduler::currentPriority()
+{
+    return (Priority)qrCodeSchedulerPriority;
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#ifndef QRCODE_SCHEDULER_H
+#define QRCODE_SCHEDULER_H
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QRunnable>
+#include <QtCore/QWaitCondition>
+
+class HarbourTask;
+class QThreadPool;
+
+// Runs HarbourTasks on the process-wide thread pool. Tasks submitted
+// to the same strand run one after another, in the order they were
+// submitted. Tasks from different strands may run concurrently. If
+// there are more tasks ready to run than there are threads in the pool,
+// the strands with higher priority go first (first come, first served
+// within the same priority). The tasks must be created with pool() and
+// submitted via a strand. Main thread only, except for the jobs (see
+// below) and currentPriority().
+class QrCodeScheduler
+{
+public:
+    enum Priority {
+        PriorityLow,
+        PriorityNormal,
+        PriorityHigh
+    };
+
+    class Job;
+    class PriorityScope;
+    class Strand;
+
+    static QThreadPool* pool();
+    static int runningCount();
+
+    // Priority of the task (or job) being run by the calling thread,
+    // PriorityNormal if it's not running any
+    static Priority currentPriority();
+
+private:
+    QrCodeScheduler();
+
+public:
+    class Private;
+};
+
+// Lightweight serial queue, typically one per model
+class QrCodeScheduler::Strand :
+    public QObject
+{
+    Q_OBJECT
+    friend class QrCodeScheduler::Private;
+
+public:
+    Strand(QObject* aParent = Q_NULLPTR,
+        QrCodeScheduler::Priority aPriority = QrCodeScheduler::PriorityNormal);
+    ~Strand();
+
+    QrCodeScheduler::Priority priority() const;
+    void setPriority(QrCodeScheduler::Priority);
+    bool isIdle() const;
+
+    // The slot is connected to the task's done() signal
+    void submit(HarbourTask*, QObject* aTarget = Q_NULLPTR,
+        const char* aSlot = Q_NULLPTR);
+
+private Q_SLOTS:
+    void onTaskFinished();
+
+private:
+    void start();
+
+private:
+    QrCodeScheduler::Priority iPriority;
+    HarbourTask* iRunning;
+    QList<HarbourTask*> iQueue;
+};
+
+// Piece of work which a running task spreads across the pool. It's
+// queued with the given priority, so that the jobs of the visible
+// models are picked up by the pool threads before the background ones.
+// The job which hasn't been picked up by the time it's waited for is
+// run by the waiting thread. Allocated with new, start() may only be
+// called once and release() must be called after wait(). Thread safe.
+class QrCodeScheduler::Job :
+    public QRunnable
+{
+    Q_DISABLE_COPY(Job)
+
+public:
+    Job();
+
+    void start(QrCodeScheduler::Priority aPriority = currentPriority());
+    void wait();
+    void release();
+
+protected:
+    virtual ~Job();
+    virtual void perform() = 0;
+
+private:
+    void run() Q_DECL_OVERRIDE;
+    bool claim();
+    void execute();
+    void unref();
+
+private:
+    QrCodeScheduler::Priority iPriority;
+    QAtomicInt iState;
+    QAtomicInt iRef;
+    QMutex iMutex;
+    QWaitCondition iDone;
+};
+
+// Sets currentPriority() for the calling thread, while it's in scope
+class QrCodeScheduler::PriorityScope
+{
+    Q_DISABLE_COPY(PriorityScope)
+
+public:
+    PriorityScope(QrCodeScheduler::Priority);
+    ~PriorityScope();
+
+private:
+    const QrCodeScheduler::Priority iPrevious;
+};
+
+#endif // QRCODE_SCHEDULER_H
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "QrCodeSnapshot.h"
+
+#include "HarbourDebug.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+
+#define QRCODE_SNAPSHOT_MAGIC   (0x51524353)  // "QRCS"
+#define QRCODE_SNAPSHOT_FORMAT  (2)
+
+// Only touched by the main thread
+static QrCodeSnapshot qrCodeStartupSnapshot;
+
+QrCodeSnapshot::QrCodeSnapshot() :
+    iStructuredAppend(false),
+    iMaxVersion(0),
+    iMicroQr(false),
+    iOptimalSegmentation(false)
+{
+}
+
+QrCodeSnapshot::QrCodeSnapshot(
+    const QString& aText,
+    bool aStructuredAppend,
+    int aMaxVersion,
+    bool aMicroQr,
+    bool aOptimalSegmentation) :
+    iHash(hash(aText)),
+    iStructuredAppend(aStructuredAppend),
+    iMaxVersion(aMaxVersion),
+    iMicroQr(aMicroQr),
+    iOptimalSegmentation(aOptimalSegmentation)
+{
+}
+
+QByteArray
+QrCodeSnapshot::hash(
+    const QString& aText)
+{
+    return QCryptographicHash::hash(aText.toUtf8(), QCryptographicHash::Sha1);
+}
+
+bool
+QrCodeSnapshot::isEmpty() const
+{
+    return iLevels.isEmpty();
+}
+
+bool
+QrCodeSnapshot::matches(
+    const QString& aText,
+    bool aStructuredAppend,
+    int aMaxVersion,
+    bool aMicroQr,
+    bool aOptimalSegmentation) const
+{
+    // Hashing is cheap compared to encoding, but still
+    // there's no need to do it if the parameters don't match
+    return !iLevels.isEmpty() &&
+        iStructuredAppend == aStructuredAppend &&
+        iMaxVersion == aMaxVersion &&
+        iMicroQr == aMicroQr &&
+        iOptimalSegmentation == aOptimalSegmentation &&
+        iHash == hash(aText);
+}
+
+void
+QrCodeSnapshot::insert(
+    int aLevel,
+    const Symbols& aSymbols)
+{
+    iLevels.insert(aLevel, aSymbols);
+}
+
+QList<int>
+QrCodeSnapshot::levels() const
+{
+    return iLevels.keys();
+}
+
+QrCodeSnapshot::Symbols
+QrCodeSnapshot::symbols(
+    int aLevel) const
+{
+    return iLevels.value(aLevel);
+}
+
+QrCodeSnapshot
+QrCodeSnapshot::load(
+    const QString& aPath)
+{
+    QrCodeSnapshot snapshot;
+    QFile file(aPath);
+
+    if (file.open(QIODevice::ReadOnly)) {
+        QDataStream in(&file);
+        quint32 magic = 0, format = 0;
+
+        in >> magic >> format;
+        if (magic == QRCODE_SNAPSHOT_MAGIC && format == QRCODE_SNAPSHOT_FORMAT) {
+            qint32 maxVersion = 0;
+            QMap<qint32,Symbols> levelMap;
+
+            in >> snapshot.iHash >> snapshot.iStructuredAppend >>
+                maxVersion >> snapshot.iMicroQr >>
+                snapshot.iOptimalSegmentation >> levelMap;
+            if (in.status() == QDataStream::Ok) {
+                snapshot.iMaxVersion = maxVersion;
+                for (QMap<qint32,Symbols>::const_iterator it = levelMap.constBegin();
+                     it != levelMap.constEnd(); ++it) {
+                    snapshot.iLevels.insert(it.key(), it.value());
+                }
+                HDEBUG(aPath << snapshot.iLevels.count() << "level(s)");
+                return snapshot;
+            }
+        }
+        HWARN("Invalid snapshot" << aPath);
+    }
+    return QrCodeSnapshot();
+}
+
+bool
+QrCodeSnapshot::save(
+    const QString& aPath) const
+{
+    // QSaveFile writes a temporary file and renames it when it's done,
+    // so that the old snapshot is either left intact or replaced
+    QDir().mkpath(QFileInfo(aPath).absolutePath());
+    QSaveFile file(aPath);
+
+    if (file.open(QIODevice::WriteOnly)) {
+        QDataStream out(&file);
+        QMap<qint32,Symbols> levelMap;
+
+        for (QMap<int,Symbols>::const_iterator it = iLevels.constBegin();
+             it != iLevels.constEnd(); ++it) {
+            levelMap.insert(it.key(), it.value());
+        }
+        out << (quint32)QRCODE_SNAPSHOT_MAGIC << (quint32)QRCODE_SNAPSHOT_FORMAT <<
+            iHash << iStructuredAppend << (qint32)iMaxVersion << iMicroQr <<
+            iOptimalSegmentation << levelMap;
+        if (out.status() == QDataStream::Ok && file.commit()) {
+            HDEBUG(aPath << iLevels.count() << "level(s)");
+            return true;
+        }
+    }
+    HWARN("Failed to save" << aPath);
+    return false;
+}
+
+void
+QrCodeSnapshot::setStartup(
+    const QrCodeSnapshot& aSnapshot)
+{
+    qrCodeStartupSnapshot = aSnapshot;
+}
+
+QrCodeSnapshot
+QrCodeSnapshot::takeStartup()
+{
+    QrCodeSnapshot snapshot(qrCodeStartupSnapshot);
+    qrCodeStartupSnapshot = QrCodeSnapshot();
+    return snapshot;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#ifndef QRCODE_SNAPSHOT_H
+#define QRCODE_SNAPSHOT_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QString>
+
+// Codes generated for the last clipboard text, saved when the app exits
+// and restored on the next start if the clipboard still has the same
+// text in it. The text itself isn't saved, only its hash. Each level is
+// a list of symbols (more than one for structured append, none if the
+// text doesn't fit), levels are numbered by QrCodeModel. The parameters
+// the codes were generated with (including the segmentation) must
+// match too.
+class QrCodeSnapshot
+{
+public:
+    typedef QList<QByteArray> Symbols;
+
+    QrCodeSnapshot();
+    QrCodeSnapshot(const QString&, bool, int, bool, bool);
+
+    bool isEmpty() const;
+    bool matches(const QString&, bool, int, bool, bool) const;
+
+    void insert(int, const Symbols&);
+    QList<int> levels() const;
+    Symbols symbols(int) const;
+
+    static QrCodeSnapshot load(const QString&);
+    bool save(const QString&) const;
+
+    // Picked up by the first QrCodeModel created after that
+    static void setStartup(const QrCodeSnapshot&);
+    static QrCodeSnapshot takeStartup();
+
+private:
+    static QByteArray hash(const QString&);
+
+private:
+    QByteArray iHash;
+    bool iStructuredAppend;
+    int iMaxVersion;
+    bool iMicroQr;
+    bool iOptimalSegmentation;
+    QMap<int,Symbols> iLevels;
+};
+
+#endif // QRCODE_SNAPSHOT_H
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "QrCodeTrace.h"
+
+#include "HarbourDebug.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+
+#define QRCODE_TRACE_ENV "QRCLIP_TRACE"
+
+// ==========================================================================
+// QrCodeTrace::Private
+// ==========================================================================
+
+class QrCodeTrace::Private
+{
+public:
+    Private();
+
+    void write(const QByteArray&, char, qint64, qint64, int);
+
+public:
+    QMutex iMutex;
+    QElapsedTimer iClock;
+    QFile iFile;
+    qint64 iPid;
+};
+
+Q_GLOBAL_STATIC(QrCodeTrace::Private, qrCodeTrace)
+
+QrCodeTrace::Private::Private() :
+    iPid(QCoreApplication::applicationPid())
+{
+    const QByteArray path(qgetenv(QRCODE_TRACE_ENV));
+
+    iClock.start();
+    if (!path.isEmpty()) {
+        iFile.setFileName(QString::fromLocal8Bit(path));
+        if (iFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            // The closing bracket is optional in the array format,
+            // which allows the file to be written incrementally
+            iFile.write("[\n");
+            iFile.flush();
+            HDEBUG("Tracing to" << qPrintable(iFile.fileName()));
+        } else {
+            HWARN("Can't open" << qPrintable(iFile.fileName()));
+        }
+    }
+}
+
+void
+QrCodeTrace::Private::write(
+    const QByteArray& aName,
+    char aPhase,
+    qint64 aStart,
+    qint64 aDuration,
+    int aThread)
+{
+    // Timestamps are in microseconds
+    QByteArray event;
+
+    event.reserve(128);
+    event.append("{\"name\":\"").append(aName).append("\",\"cat\":\"qrclip\"");
+    event.append(",\"ph\":\"").append(aPhase).append('"');
+    event.append(",\"ts\":").append(QByteArray::number(aStart / 1000.0, 'f', 3));
+    if (aPhase == 'X') {
+        event.append(",\"dur\":").append(QByteArray::number(aDuration / 1000.0, 'f', 3));
+    } else {
+        event.append(",\"s\":\"t\"");
+    }
+    event.append(",\"pid\":").append(QByteArray::number(iPid));
+    event.append(",\"tid\":").append(QByteArray::number(aThread));
+    event.append("},\n");
+
+    QMutexLocker lock(&iMutex);
+    iFile.write(event);
+    iFile.flush();
+}
+
+// ==========================================================================
+// QrCodeTrace
+// ==========================================================================
+
+bool
+QrCodeTrace::isEnabled()
+{
+    return qrCodeTrace()->iFile.isOpen();
+}
+
+qint64
+QrCodeTrace::now()
+{
+    return qrCodeTrace()->iClock.nsecsElapsed();
+}
+
+void
+QrCodeTrace::complete(
+    const QByteArray& aName,
+    qint64 aStart,
+    qint64 aDuration,
+    int aThread)
+{
+    Private* trace = qrCodeTrace();
+    if (trace->iFile.isOpen()) {
+        trace->write(aName, 'X', aStart, aDuration, aThread);
+    }
+}
+
+void
+QrCodeTrace::instant(
+    const QByteArray& aName,
+    qint64 aTime,
+    int aThread)
+{
+    Private* trace = qrCodeTrace();
+    if (trace->iFile.isOpen()) {
+        trace->write(aName, 'i', aTime, 0, aThread);
+    }
+}
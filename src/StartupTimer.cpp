@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer
+ *     in the documentation and/or other materials provided with the
+ *     distribution.
+ *
+ *  3. Neither the names of the copyright holders nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as representing
+ * any official policies, either expressed or implied.
+ */
+
+#include "StartupTimer.h"
+#include "QrCodeTrace.h"
+
+#include "HarbourDebug.h"
+
+#include <QtQuick/QQuickWindow>
+
+StartupTimer::StartupTimer(
+    QObject* aParent) :
+    QObject(aParent),
+    iWindow(Q_NULLPTR),
+    iStart(QrCodeTrace::now()),
+    iLast(iStart)
+{
+}
+
+void
+StartupTimer::phase(
+    const char* aName)
+{
+    const qint64 now = QrCodeTrace::now();
+
+    HDEBUG(aName << (now - iLast) / 1000000.0 << "ms");
+    QrCodeTrace::complete(QByteArray("startup ") + aName, iLast, now - iLast);
+    iLast = now;
+}
+
+void
+StartupTimer::firstFrame(
+    QQuickWindow* aWindow)
+{
+    // The signal may be emitted by the render thread. The slot is
+    // invoked directly, so that the time isn't skewed by whatever
+    // the main thread is busy with at that point.
+    iWindow = aWindow;
+    connect(aWindow, SIGNAL(frameSwapped()), SLOT(onFrameSwapped()),
+        Qt::DirectConnection);
+}
+
+void
+StartupTimer::onFrameSwapped()
+{
+    iWindow->disconnect(this);
+    phase("first frame");
+    HDEBUG("Started in" << (iLast - iStart) / 1000000.0 << "ms");
+    QrCodeTrace::complete("startup", iStart, iLast - iStart);
+    deleteLater();
+}
@@ -37,16 +37,23 @@
  * any official policies, either expressed or implied.
  */
 
+#include "BatchEncoder.h"
 #include "FileUtils.h"
+#include "QrCodeGenerator.h"
+#include "QrCodeHistoryModel.h"
+#include "QrCodeImageProvider.h"
 #include "QrCodeModel.h"
+#include "QrCodeSnapshot.h"
+#include "StartupTimer.h"
 
 #include "HarbourClipboard.h"
 #include "HarbourQrCodeGenerator.h"
-#include "HarbourQrCodeImageProvider.h"
 #include "HarbourDebug.h"
 
 #include <sailfishapp.h>
 
+#include <QtCore/QFile>
+
 #include <QtGui/QGuiApplication>
 #include <QtQuick/QtQuick>
 
@@ -58,6 +65,8 @@
 
 #define QRCLIP_QML_IMPORT  "harbour.qrclip"
 #define QRCLIP_DCONF_ROOT  "/apps/" QRCLIP_APP_NAME "/"
+#define QRCLIP_SNAPSHOT    "snapshot"
+#define QRCLIP_PARALLEL_MASK_ENV "QRCLIP_PARALLEL_MASK"
 
 #define REGISTER_TYPE(class,uri,v1,v2) \
     qmlRegisterType<class>(uri, v1, v2, #class)
@@ -71,15 +80,42 @@ static void register_types(const char* uri, int v1 = 1, int v2 = 0)
     REGISTER_SINGLETON(FileUtils, uri, v1, v2);
     REGISTER_SINGLETON(HarbourClipboard, uri, v1, v2);
     REGISTER_UNCREATABLE(HarbourQrCodeGenerator, uri, v1, v2);
+    REGISTER_TYPE(QrCodeHistoryModel, uri, v1, v2);
     REGISTER_TYPE(QrCodeModel, uri, v1, v2);
 }
 
+static QString snapshot_path()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+        QLatin1String("/" QRCLIP_SNAPSHOT);
+}
+
 int main(int argc, char *argv[])
 {
+    // Opt-in parallel mask trials, the value is the minimal version
+    const QByteArray parallelMask(qgetenv(QRCLIP_PARALLEL_MASK_ENV));
+    if (!parallelMask.isEmpty()) {
+        QrCodeGenerator::setParallelMaskVersion(parallelMask.toInt());
+    }
+
+    if (BatchEncoder::isBatchMode(argc, argv)) {
+        // No GUI in batch mode
+        QCoreApplication app(argc, argv);
+        app.setApplicationName(QRCLIP_APP_NAME);
+        return BatchEncoder::run(app.arguments());
+    }
+
+    StartupTimer* startup = new StartupTimer;
     QGuiApplication* app = SailfishApp::application(argc, argv);
 
     app->setApplicationName(QRCLIP_APP_NAME);
     register_types(QRCLIP_QML_IMPORT, 1, 0);
+    startup->phase("application");
+
+    // Codes saved last time, picked up by QrCodeModel if the text
+    // in the clipboard is still the same
+    QrCodeSnapshot::setStartup(QrCodeSnapshot::load(snapshot_path()));
+    startup->phase("snapshot");
 
     // Load translations
     QLocale locale;
@@ -93,21 +129,38 @@ int main(int argc, char *argv[])
         HDEBUG("Failed to load translator for" << locale << "from" << qPrintable(transDir));
         delete tr;
     }
+    startup->phase("translator");
 
     // Create the view
     QQuickView* view = SailfishApp::createView();
     QQmlContext* context = view->rootContext();
     QQmlEngine* engine = context->engine();
 
-    engine->addImageProvider("qrcode", new HarbourQrCodeImageProvider);
+    engine->addImageProvider("qrcode", new QrCodeImageProvider);
+    startup->phase("view");
 
     // Initialize the view and show it
     view->setTitle(qtTrId("qrclip-app_name"));
     view->setSource(SailfishApp::pathTo("qml/main.qml"));
+    startup->phase("qml");
+    startup->firstFrame(view);
     view->showFullScreen();
 
     int ret = app->exec();
 
+    // Save the codes for the next start
+    QObject* root = view->rootObject();
+    QrCodeModel* model = root ? root->findChild<QrCodeModel*>() : Q_NULLPTR;
+    if (model) {
+        const QrCodeSnapshot snapshot(model->snapshot());
+        if (snapshot.isEmpty()) {
+            // Don't show the stale codes on the next start
+            QFile::remove(snapshot_path());
+        } else {
+            snapshot.save(snapshot_path());
+        }
+    }
+
     delete view;
     delete app;
     return ret;
@@ -13,11 +13,46 @@
         <extracomment>Pulley menu item</extracomment>
         <translation>Tallenna Galleriaan</translation>
     </message>
+    <message id="qrclip-menu-micro_level">
+        <source>Micro QR, level %1</source>
+        <extracomment>Pulley menu label</extracomment>
+        <translation type="unfinished"></translation>
+    </message>
     <message id="qrclip-menu-level">
         <source>Level %1</source>
         <extracomment>Pulley menu label</extracomment>
         <translation>Taso %1</translation>
     </message>
+    <message id="qrclip-error-save_failed">
+        <source>Failed to save the image.</source>
+        <extracomment>Error message</extracomment>
+        <translation type="unfinished"></translation>
+    </message>
+    <message id="qrclip-menu-history">
+        <source>History</source>
+        <extracomment>Pulley menu item</extracomment>
+        <translation type="unfinished"></translation>
+    </message>
+    <message id="qrclip-history-header">
+        <source>History</source>
+        <extracomment>Page header</extracomment>
+        <translation type="unfinished"></translation>
+    </message>
+    <message id="qrclip-history-menu-clear">
+        <source>Clear history</source>
+        <extracomment>Pulley menu item</extracomment>
+        <translation type="unfinished"></translation>
+    </message>
+    <message id="qrclip-history-menu-remove">
+        <source>Remove</source>
+        <extracomment>Context menu item</extracomment>
+        <translation type="unfinished"></translation>
+    </message>
+    <message id="qrclip-history-placeholder">
+        <source>History is empty.</source>
+        <extracomment>Placeholder text</extracomment>
+        <translation type="unfinished"></translation>
+    </message>
     <message id="qrclip-placeholder-text_too_long">
         <source>Text in clipboard is too long for QR code.</source>
         <extracomment>Placeholder text</extracomment>